@@ -0,0 +1,757 @@
+# include "blk.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <limits.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+
+# if defined(__linux__) && defined(__has_include)
+#   if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#     include <linux/io_uring.h>
+#     define _BLK_URING
+#   endif
+# endif
+
+# ifndef IOV_MAX
+#   define IOV_MAX 1024
+# endif
+
+# define _BLK_RING_ENTRIES 64
+
+struct _cache_blk_run_t {
+  off_t          off;
+  size_t         len;
+  struct iovec * iov;
+  int            iovc;
+};
+
+static void _cache_blk_iov_skip (
+  _InOut struct iovec ** iov,
+  _InOut int *           iovc,
+  _In    size_t          len
+)
+{
+  while (*iovc && (*iov)->iov_len <= len) {
+    len -= (*iov)->iov_len;
+    ++*iov;
+    --*iovc;
+  }
+
+  if (*iovc) {
+    (*iov)->iov_base  = (char *)(*iov)->iov_base + len;
+    (*iov)->iov_len  -= len;
+  }
+}
+
+static int _cache_blk_pwritev (
+  _InOut struct cache_blk_t * blk,
+  _InOut struct iovec *       iov,
+  _In    int                  iovc,
+  _In    off_t                off
+)
+{
+  while (iovc) {
+    ssize_t res = pwritev(blk->fd, iov, iovc, off);
+
+    ++blk->wr_ioc;
+
+    if (res < 0) {
+      if (EINTR == errno)
+        continue;
+
+      return CACHE_FAILURE;
+    }
+
+    off += res;
+    _cache_blk_iov_skip(&iov, &iovc, (size_t)res);
+  }
+
+  return CACHE_SUCCESS;
+}
+
+# ifdef _BLK_URING
+
+struct _cache_blk_ring_t {
+  int                   fd;
+  u_word_t              entries;
+  u_byte_t *            sq_ptr;
+  size_t                sq_len;
+  u_byte_t *            cq_ptr;
+  size_t                cq_len;
+  struct io_uring_sqe * sqes;
+  size_t                sqes_len;
+  unsigned *            sq_tail;
+  unsigned *            sq_mask;
+  unsigned *            sq_array;
+  unsigned *            cq_head;
+  unsigned *            cq_tail;
+  unsigned *            cq_mask;
+  struct io_uring_cqe * cqes;
+};
+
+static void _cache_blk_ring_dtor (
+  _InOut struct _cache_blk_ring_t * ring
+)
+{
+  if (!ring)
+    return;
+
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_len);
+
+  if (ring->cq_ptr)
+    munmap(ring->cq_ptr, ring->cq_len);
+
+  if (ring->sq_ptr)
+    munmap(ring->sq_ptr, ring->sq_len);
+
+  close(ring->fd);
+  free(ring);
+}
+
+static struct _cache_blk_ring_t * _cache_blk_ring_ctor (
+  _In    u_word_t entries
+)
+{
+  struct io_uring_params par;
+  memset(&par, 0, sizeof(par));
+
+  int fd = (int)syscall(__NR_io_uring_setup, entries, &par);
+
+  if (fd < 0)
+    return NULL;
+
+  struct _cache_blk_ring_t * ring = (struct _cache_blk_ring_t *)calloc(
+    1, sizeof(struct _cache_blk_ring_t)
+  );
+
+  if (!ring) {
+    close(fd);
+    return NULL;
+  }
+
+  ring->fd       = fd;
+  ring->entries  = par.sq_entries;
+  ring->sq_len   = par.sq_off.array + par.sq_entries * sizeof(unsigned);
+  ring->cq_len   = par.cq_off.cqes  + par.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_len = par.sq_entries * sizeof(struct io_uring_sqe);
+
+  void * sq_ptr = mmap(
+    NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING
+  );
+  void * cq_ptr = mmap(
+    NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING
+  );
+  void * sqes   = mmap(
+    NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES
+  );
+
+  ring->sq_ptr = MAP_FAILED == sq_ptr ? NULL : (u_byte_t *)sq_ptr;
+  ring->cq_ptr = MAP_FAILED == cq_ptr ? NULL : (u_byte_t *)cq_ptr;
+  ring->sqes   = MAP_FAILED == sqes   ? NULL : (struct io_uring_sqe *)sqes;
+
+  if (!ring->sq_ptr || !ring->cq_ptr || !ring->sqes) {
+    _cache_blk_ring_dtor(ring);
+    return NULL;
+  }
+
+  ring->sq_tail  = (unsigned *)(ring->sq_ptr + par.sq_off.tail);
+  ring->sq_mask  = (unsigned *)(ring->sq_ptr + par.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(ring->sq_ptr + par.sq_off.array);
+  ring->cq_head  = (unsigned *)(ring->cq_ptr + par.cq_off.head);
+  ring->cq_tail  = (unsigned *)(ring->cq_ptr + par.cq_off.tail);
+  ring->cq_mask  = (unsigned *)(ring->cq_ptr + par.cq_off.ring_mask);
+  ring->cqes     = (struct io_uring_cqe *)(ring->cq_ptr + par.cq_off.cqes);
+
+  return ring;
+}
+
+/*
+ * Submit up to `entries` runs as WRITEV requests and reap them all. Short
+ * writes are completed with `pwritev`. On a submission error the requests
+ * already submitted are reaped, the ring is given up and only the other
+ * runs are written synchronously; if waiting for completions fails the
+ * ring is given up too and the sync fails.
+ */
+
+static int _cache_blk_ring_writev (
+  _InOut struct cache_blk_t *      blk,
+  _InOut struct _cache_blk_run_t * runv,
+  _In    u_word_t                  runc
+)
+{
+  struct _cache_blk_ring_t * ring = (struct _cache_blk_ring_t *)blk->ring;
+
+  unsigned tail = *ring->sq_tail;
+  unsigned mask = *ring->sq_mask;
+  u_word_t runi;
+
+  for (runi = U_WORD(0); runi < runc; ++runi, ++tail) {
+    struct io_uring_sqe * sqe = ring->sqes + (tail & mask);
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_WRITEV;
+    sqe->fd        = blk->fd;
+    sqe->addr      = (u_long_t)(uintptr_t)runv[runi].iov;
+    sqe->len       = (u_word_t)runv[runi].iovc;
+    sqe->off       = (u_long_t)runv[runi].off;
+    sqe->user_data = runi;
+
+    ring->sq_array[tail & mask] = tail & mask;
+  }
+
+  __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+  u_word_t sent = U_WORD(0);
+  u_word_t done = U_WORD(0);
+
+  while (sent < runc) {
+    long res = syscall(
+      __NR_io_uring_enter, ring->fd, runc - sent, 0, 0, NULL, 0
+    );
+
+    if (res < 0 && EINTR == errno)
+      continue;
+
+    if (res <= 0)
+      break;
+
+    sent += (u_word_t)res;
+    ++blk->wr_ioc;
+  }
+
+  int ret = CACHE_SUCCESS;
+
+  while (done < sent) {
+    unsigned head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+      long res = syscall(
+        __NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+        NULL, 0
+      );
+
+      if (res < 0 && EINTR != errno) {
+        _cache_blk_ring_dtor(ring);
+        blk->ring = NULL;
+        return CACHE_FAILURE;
+      }
+
+      continue;
+    }
+
+    struct io_uring_cqe *     cqe = ring->cqes + (head & *ring->cq_mask);
+    struct _cache_blk_run_t * run = runv + cqe->user_data;
+
+    if (cqe->res < 0) {
+      ret = CACHE_FAILURE;
+    } else if ((size_t)cqe->res < run->len) {
+      _cache_blk_iov_skip(&run->iov, &run->iovc, (size_t)cqe->res);
+
+      if (_cache_blk_pwritev(blk, run->iov, run->iovc, run->off + cqe->res))
+        ret = CACHE_FAILURE;
+    }
+
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    ++done;
+  }
+
+  if (sent == runc)
+    return ret;
+
+  _cache_blk_ring_dtor(ring);
+  blk->ring = NULL;
+
+  for (runi = sent; runi < runc && !ret; ++runi) {
+    ret = _cache_blk_pwritev(
+      blk, runv[runi].iov, runv[runi].iovc, runv[runi].off
+    );
+  }
+
+  return ret;
+}
+
+# endif
+
+static int _cache_blk_push (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             adr,
+  _In    const u_byte_t *     way_hdr,
+  _In    const u_byte_t *     dat,
+  _In    u_word_t             seci,
+  _In    u_word_t             secn
+)
+{
+  if (blk->entc == blk->entz) {
+    u_word_t                 entz = blk->entz ? blk->entz * 2 : U_WORD(256);
+    struct cache_blk_ent_t * entv = (struct cache_blk_ent_t *)realloc(
+      blk->entv, entz * sizeof(struct cache_blk_ent_t)
+    );
+
+    if (!entv)
+      return CACHE_FAILURE;
+
+    blk->entv = entv;
+    blk->entz = entz;
+  }
+
+  u_word_t secz = U_WORD(1) << blk->cache.secs;
+
+  struct cache_blk_ent_t * ent = blk->entv + blk->entc++;
+
+  ent->adr     = adr + seci * secz;
+  ent->way_hdr = (u_byte_t *)way_hdr;
+  ent->dat     = (u_byte_t *)dat + seci * secz;
+  ent->len     = secn * secz;
+  ent->seci    = seci;
+  ent->secn    = secn;
+
+  return CACHE_SUCCESS;
+}
+
+/*
+ * Flush and evict callback: writes the dirty sectors of a way in place, or
+ * records them for `cache_blk_sync` while it collects.
+ */
+
+static int _cache_blk_flush (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    const u_byte_t * way_hdr,
+  _In    const u_byte_t * way_dat
+)
+{
+  struct cache_blk_t * blk = (struct cache_blk_t *)cache;
+
+  u_word_t wayi = cache_way_index(cache, way_hdr);
+  u_long_t adr  = cache_way_get_adr(cache, seti, wayi, way_hdr);
+  u_word_t entc = blk->entc;
+  u_word_t seci = U_WORD(0);
+  u_word_t secn;
+
+  while (seci < cache->secc) {
+    if (
+      cache->secc > U_WORD(1) &&
+      !cache_way_get_sec_dirty(cache, way_hdr, seci)
+    ) {
+      ++seci;
+      continue;
+    }
+
+    for (secn = U_WORD(1); seci + secn < cache->secc; ++secn) {
+      if (!cache_way_get_sec_dirty(cache, way_hdr, seci + secn))
+        break;
+    }
+
+    if (_cache_blk_push(blk, adr, way_hdr, way_dat, seci, secn))
+      return -1;
+
+    seci += secn;
+  }
+
+  if (cache_blk_get_cl(blk))
+    return 0;
+
+  /* eviction: write the recorded runs now */
+
+  u_word_t enti;
+
+  for (enti = entc; enti < blk->entc; ++enti) {
+    struct iovec iov = {
+      .iov_base = blk->entv[enti].dat,
+      .iov_len  = blk->entv[enti].len
+    };
+
+    if (_cache_blk_pwritev(blk, &iov, 1, (off_t)blk->entv[enti].adr)) {
+      blk->entc = entc;
+      return -1;
+    }
+  }
+
+  blk->entc = entc;
+
+  return 0;
+}
+
+static int _cache_blk_ent_cmp (
+  _In    const void * lhs,
+  _In    const void * rhs
+)
+{
+  const struct cache_blk_ent_t * l = (const struct cache_blk_ent_t *)lhs;
+  const struct cache_blk_ent_t * r = (const struct cache_blk_ent_t *)rhs;
+
+  return (l->adr > r->adr) - (l->adr < r->adr);
+}
+
+static void _cache_blk_redirty (
+  _InOut struct cache_blk_t * blk
+)
+{
+  struct cache_t * cache = &blk->cache;
+  u_word_t         enti, seci, dati;
+
+  for (enti = U_WORD(0); enti < blk->entc; ++enti) {
+    struct cache_blk_ent_t * ent = blk->entv + enti;
+
+    cache_way_set_dirty(cache, ent->way_hdr);
+
+    if (cache->secc < U_WORD(2))
+      continue;
+
+    for (seci = ent->seci; seci < ent->seci + ent->secn; ++seci) {
+      cache_way_sec_dirty(cache, ent->way_hdr)[seci >> 3] |= (
+        U_BYTE(1) << (seci & 7)
+      );
+    }
+
+    u_word_t lo = ent->seci << cache->secs;
+
+    for (dati = lo; dati < lo + ent->len; ++dati) {
+      cache_way_dat_dirty(cache, ent->way_hdr)[dati >> 3] |= (
+        U_BYTE(1) << (dati & 7)
+      );
+    }
+  }
+
+  blk->entc = U_WORD(0);
+}
+
+int cache_blk_sync (
+  _InOut struct cache_blk_t * blk
+)
+{
+  blk->entc = U_WORD(0);
+
+  cache_blk_set_cl(blk);
+  int res = cache_flush(&blk->cache, NULL, NULL);
+  cache_blk_clr_cl(blk);
+
+  if (res) {
+    _cache_blk_redirty(blk);
+    return CACHE_FAILURE;
+  }
+
+  if (!blk->entc)
+    return CACHE_SUCCESS;
+
+  qsort(blk->entv, blk->entc, sizeof(struct cache_blk_ent_t), _cache_blk_ent_cmp);
+
+  struct iovec *            iovv = (struct iovec *)malloc(
+    blk->entc * sizeof(struct iovec)
+  );
+  struct _cache_blk_run_t * runv = (struct _cache_blk_run_t *)malloc(
+    blk->entc * sizeof(struct _cache_blk_run_t)
+  );
+
+  if (!iovv || !runv) {
+    free(iovv);
+    free(runv);
+    _cache_blk_redirty(blk);
+    return CACHE_FAILURE;
+  }
+
+  /* coalesce contiguous lines into runs of at most IOV_MAX vectors */
+
+  u_word_t runc = U_WORD(0);
+  u_word_t enti;
+
+  for (enti = U_WORD(0); enti < blk->entc; ++enti) {
+    struct cache_blk_ent_t *  ent = blk->entv + enti;
+    struct _cache_blk_run_t * run = runc ? runv + runc - 1 : NULL;
+
+    iovv[enti].iov_base = ent->dat;
+    iovv[enti].iov_len  = ent->len;
+
+    if (
+      !run                                     ||
+      IOV_MAX == run->iovc                     ||
+      (u_long_t)run->off + run->len != ent->adr
+    ) {
+      run       = runv + runc++;
+      run->off  = (off_t)ent->adr;
+      run->len  = 0;
+      run->iov  = iovv + enti;
+      run->iovc = 0;
+    }
+
+    run->len  += ent->len;
+    run->iovc += 1;
+  }
+
+  u_word_t runi = U_WORD(0);
+
+  res = CACHE_SUCCESS;
+
+# ifdef _BLK_URING
+  while (blk->ring && runi < runc && !res) {
+    struct _cache_blk_ring_t * ring = (struct _cache_blk_ring_t *)blk->ring;
+
+    u_word_t runn = runc - runi;
+
+    if (runn > ring->entries) {
+      runn = ring->entries;
+    }
+
+    res   = _cache_blk_ring_writev(blk, runv + runi, runn);
+    runi += runn;
+  }
+# endif
+
+  for (; runi < runc && !res; ++runi) {
+    res = _cache_blk_pwritev(blk, runv[runi].iov, runv[runi].iovc, runv[runi].off);
+  }
+
+  free(iovv);
+  free(runv);
+
+  if (res) {
+    _cache_blk_redirty(blk);
+    return CACHE_FAILURE;
+  }
+
+  blk->entc = U_WORD(0);
+
+  return CACHE_SUCCESS;
+}
+
+struct cache_blk_t * cache_blk_ctor (
+  _InOut struct cache_blk_t * blk,
+  _In    const char *         path,
+  _In    int                  flags,
+  _In    u_word_t             rac
+)
+{
+  /* the geometry comes with `blk->cache`, so there is nothing to allocate */
+
+  if (!blk)
+    return NULL;
+
+  blk->sr      = 0;
+  blk->fd      = -1;
+  blk->rac     = rac ? rac : U_WORD(1);
+  blk->ra_next = U_LONG_MAX;
+  blk->ra_buf  = NULL;
+  blk->entc    = U_WORD(0);
+  blk->entz    = U_WORD(0);
+  blk->entv    = NULL;
+  blk->ring    = NULL;
+  blk->rd_ioc  = U_LONG(0);
+  blk->wr_ioc  = U_LONG(0);
+
+  blk->cache.flush = _cache_blk_flush;
+  blk->cache.evict = _cache_blk_flush;
+
+  if (!cache_ctor(&blk->cache, 0, NULL))
+    return NULL;
+
+  if (
+    blk->cache.smpz           ||
+    cache_get_cc(&blk->cache) ||
+    cache_get_to(&blk->cache) ||
+    cache_get_ph(&blk->cache) ||
+    cache_reset(&blk->cache, NULL)
+  ) {
+    blk = cache_blk_dtor(blk);
+    return NULL;
+  }
+
+  blk->fd     = open(path, flags, 0644);
+  blk->ra_buf = (u_byte_t *)malloc((size_t)blk->rac * blk->cache.datc);
+
+  if (blk->fd < 0 || !blk->ra_buf) {
+    blk = cache_blk_dtor(blk);
+    return NULL;
+  }
+
+# ifdef _BLK_URING
+  blk->ring = _cache_blk_ring_ctor(_BLK_RING_ENTRIES);
+# endif
+
+  return blk;
+}
+
+struct cache_blk_t * cache_blk_dtor (
+  _InOut struct cache_blk_t * blk
+)
+{
+  if (!blk)
+    return blk;
+
+  if (blk->fd >= 0) {
+    cache_blk_sync(blk);
+    close(blk->fd);
+    blk->fd = -1;
+  }
+
+# ifdef _BLK_URING
+  _cache_blk_ring_dtor((struct _cache_blk_ring_t *)blk->ring);
+# endif
+
+  blk->ring = NULL;
+
+  free(blk->ra_buf);
+  free(blk->entv);
+  blk->ra_buf = NULL;
+  blk->entv   = NULL;
+
+  cache_dtor(&blk->cache);
+
+  if (cache_blk_get_ho(blk)) {
+    free(blk);
+    blk = NULL;
+  }
+
+  return blk;
+}
+
+/* read line `lini` from the file, with a read-ahead window if sequential */
+
+static int _cache_blk_miss (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             lini
+)
+{
+  struct cache_t * cache = &blk->cache;
+
+  u_word_t linc = lini == blk->ra_next ? blk->rac : U_WORD(1);
+  size_t   len  = (size_t)linc * cache->datc;
+  ssize_t  res;
+
+  do {
+    res = pread(blk->fd, blk->ra_buf, len, (off_t)(lini * cache->datc));
+  } while (res < 0 && EINTR == errno);
+
+  ++blk->rd_ioc;
+
+  if (res < 0)
+    return CACHE_FAILURE;
+
+  memset(blk->ra_buf + res, 0, len - (size_t)res);
+
+  /* the requested line last, so read-ahead never evicts it */
+
+  u_word_t lin = linc;
+
+  while (lin--) {
+    if (lin && (size_t)res <= (size_t)lin * cache->datc)
+      continue;
+
+    int ret = cache_fill(
+      cache, (lini + lin) * cache->datc, blk->ra_buf + lin * cache->datc
+    );
+
+    if (ret)
+      return CACHE_FAILURE;
+  }
+
+  blk->ra_next = lini + linc;
+
+  return CACHE_SUCCESS;
+}
+
+int cache_blk_read (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             off,
+  _In    u_long_t             len,
+  _Out   u_byte_t *           buf
+)
+{
+  struct cache_t * cache = &blk->cache;
+
+  while (len) {
+    u_word_t dati = (u_word_t)off & cache->datm;
+    u_word_t datn = cache->datc - dati;
+
+    if (len < datn) {
+      datn = (u_word_t)len;
+    }
+
+    int res = cache_read(cache, off, datn, buf);
+
+    /* the miss is counted once: the filled line is pinned without a count */
+
+    if (CACHE_FAILURE == res) {
+      struct cache_pin_t pin;
+
+      if (_cache_blk_miss(blk, off / cache->datc))
+        return CACHE_FAILURE;
+
+      res = cache_pin_retry(cache, off, datn, &pin);
+
+      if (!res) {
+        memcpy(buf, pin.dat + dati, datn);
+        cache_unpin(cache, &pin);
+      }
+    }
+
+    if (res)
+      return res;
+
+    off += datn;
+    buf += datn;
+    len -= datn;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+int cache_blk_write (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             off,
+  _In    u_long_t             len,
+  _In    const u_byte_t *     buf
+)
+{
+  struct cache_t * cache = &blk->cache;
+
+  while (len) {
+    u_word_t dati = (u_word_t)off & cache->datm;
+    u_word_t datn = cache->datc - dati;
+
+    if (len < datn) {
+      datn = (u_word_t)len;
+    }
+
+    /* partial lines are fetched first and patched in place */
+
+    int res;
+
+    if (datn < cache->datc) {
+      struct cache_pin_t pin;
+
+      res = cache_pin(cache, off, datn, &pin);
+
+      if (CACHE_FAILURE == res) {
+        if (_cache_blk_miss(blk, off / cache->datc))
+          return CACHE_FAILURE;
+
+        res = cache_pin_retry(cache, off, datn, &pin);
+      }
+
+      if (!res) {
+        memcpy(pin.dat + dati, buf, datn);
+        cache_pin_dirty(cache, &pin, dati, datn);
+        cache_unpin(cache, &pin);
+      }
+    } else {
+      res = cache_write(cache, off, datn, buf);
+    }
+
+    if (res)
+      return res;
+
+    off += datn;
+    buf += datn;
+    len -= datn;
+  }
+
+  return CACHE_SUCCESS;
+}
@@ -0,0 +1,84 @@
+# ifndef __BLK_H
+#   define __BLK_H
+
+#   include "cache.h"
+
+/*
+ * File-backed block cache: the set-associative engine in front of a file
+ * or block device, where cache addresses are file offsets. Misses read the
+ * line from the file (a whole read-ahead window on sequential misses),
+ * evicted dirty lines are written back in place, and `cache_blk_sync`
+ * coalesces every dirty line into sorted, contiguous vectored writes,
+ * submitted through io_uring when the kernel allows it and `pwritev`
+ * otherwise.
+ *
+ * The caller sets the geometry and the policy callbacks of `cache` as for
+ * `cache_ctor`, so `blk` must be provided; `cache_blk_ctor` owns the
+ * `flush` and `evict` callbacks. Sampling, concurrent, tag-only and packed
+ * header modes are not supported, the latter because entries point at the
+ * stored headers.
+ */
+
+struct cache_blk_ent_t {
+  u_long_t   adr;
+  u_byte_t * way_hdr;
+  u_byte_t * dat;
+  u_word_t   len;
+  u_word_t   seci; /* first dirty sector */
+  u_word_t   secn; /* dirty sectors      */
+};
+
+struct cache_blk_t {
+  struct cache_t           cache; /* must be first */
+  u_word_t                 sr;
+  int                      fd;
+  u_word_t                 rac;   /* in lines */
+  u_long_t                 ra_next;
+  u_byte_t *               ra_buf;
+  u_word_t                 entc;
+  u_word_t                 entz;
+  struct cache_blk_ent_t * entv;
+  void *                   ring;
+  u_long_t                 rd_ioc;
+  u_long_t                 wr_ioc;
+};
+
+#   define cache_blk_clr_ho(blk) (blk)->sr &= ~0x1
+#   define cache_blk_clr_cl(blk) (blk)->sr &= ~0x2
+
+#   define cache_blk_set_ho(blk) (blk)->sr |= 0x1
+#   define cache_blk_set_cl(blk) (blk)->sr |= 0x2
+
+#   define cache_blk_get_ho(blk) ((blk)->sr & 0x1)
+#   define cache_blk_get_cl(blk) ((blk)->sr & 0x2)
+
+struct cache_blk_t * cache_blk_ctor (
+  _InOut struct cache_blk_t * blk,
+  _In    const char *         path,
+  _In    int                  flags,
+  _In    u_word_t             rac
+);
+
+struct cache_blk_t * cache_blk_dtor (
+  _InOut struct cache_blk_t * blk
+);
+
+int cache_blk_read (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             off,
+  _In    u_long_t             len,
+  _Out   u_byte_t *           buf
+);
+
+int cache_blk_write (
+  _InOut struct cache_blk_t * blk,
+  _In    u_long_t             off,
+  _In    u_long_t             len,
+  _In    const u_byte_t *     buf
+);
+
+int cache_blk_sync (
+  _InOut struct cache_blk_t * blk
+);
+
+# endif
@@ -0,0 +1,428 @@
+# include "c3.h"
+# include <stdlib.h>
+# include <string.h>
+
+# define _C3_EMPTY U_LONG_MAX
+# define _C3_NIL   U_WORD_MAX
+
+static inline u_long_t _cache_c3_hash (
+  _In    u_long_t key,
+  _In    u_word_t hashz
+)
+{
+  return (key * U_LONG(0x9E3779B97F4A7C15)) >> (64 - hashz);
+}
+
+/* first-touch set, doubled at half load */
+
+static int _cache_c3_see_init (
+  _InOut struct cache_c3_t * c3,
+  _In    u_word_t            seez
+)
+{
+  u_long_t * see_buf = (u_long_t *)malloc(
+    (size_t)(U_LONG(1) << seez) * sizeof(u_long_t)
+  );
+
+  if (!see_buf)
+    return CACHE_FAILURE;
+
+  memset(see_buf, 0xFF, (size_t)(U_LONG(1) << seez) * sizeof(u_long_t));
+
+  c3->seez    = seez;
+  c3->seem    = (U_LONG(1) << seez) - U_LONG(1);
+  c3->see_buf = see_buf;
+
+  return CACHE_SUCCESS;
+}
+
+static u_long_t _cache_c3_see_find (
+  _In    const struct cache_c3_t * c3,
+  _In    u_long_t                  lin
+)
+{
+  u_long_t idx = _cache_c3_hash(lin, c3->seez);
+
+  while (_C3_EMPTY != c3->see_buf[idx] && lin != c3->see_buf[idx]) {
+    idx = (idx + 1) & c3->seem;
+  }
+
+  return idx;
+}
+
+static int _cache_c3_see_grow (
+  _InOut struct cache_c3_t * c3
+)
+{
+  u_long_t * old_buf = c3->see_buf;
+  u_long_t   old_len = c3->seem + U_LONG(1);
+  u_word_t   old_z   = c3->seez;
+  u_long_t   idx;
+
+  if (_cache_c3_see_init(c3, c3->seez + U_WORD(1))) {
+    c3->see_buf = old_buf;
+    c3->seez    = old_z;
+    c3->seem    = old_len - U_LONG(1);
+    return CACHE_FAILURE;
+  }
+
+  for (idx = U_LONG(0); idx < old_len; ++idx) {
+    if (_C3_EMPTY != old_buf[idx]) {
+      c3->see_buf[_cache_c3_see_find(c3, old_buf[idx])] = old_buf[idx];
+    }
+  }
+
+  free(old_buf);
+
+  return CACHE_SUCCESS;
+}
+
+/* shadow fully associative LRU: map from line to list node */
+
+static u_long_t _cache_c3_map_find (
+  _In    const struct cache_c3_t * c3,
+  _In    u_long_t                  lin
+)
+{
+  u_long_t idx = _cache_c3_hash(lin, c3->mapz);
+
+  while (_C3_EMPTY != c3->map_key[idx] && lin != c3->map_key[idx]) {
+    idx = (idx + 1) & c3->mapm;
+  }
+
+  return idx;
+}
+
+static void _cache_c3_map_del (
+  _InOut struct cache_c3_t * c3,
+  _In    u_long_t            idx
+)
+{
+  u_long_t nxt = idx;
+
+  for (;;) {
+    nxt = (nxt + 1) & c3->mapm;
+
+    if (_C3_EMPTY == c3->map_key[nxt])
+      break;
+
+    u_long_t home = _cache_c3_hash(c3->map_key[nxt], c3->mapz);
+
+    /* keep entries whose home lies cyclically in ( idx, nxt ] */
+
+    if (((nxt - home) & c3->mapm) < ((nxt - idx) & c3->mapm))
+      continue;
+
+    c3->map_key[idx] = c3->map_key[nxt];
+    c3->map_val[idx] = c3->map_val[nxt];
+    idx = nxt;
+  }
+
+  c3->map_key[idx] = _C3_EMPTY;
+}
+
+static void _cache_c3_lru_unlink (
+  _InOut struct cache_c3_t * c3,
+  _In    u_word_t            lini
+)
+{
+  u_word_t prv = c3->prv_buf[lini];
+  u_word_t nxt = c3->nxt_buf[lini];
+
+  if (_C3_NIL == prv) {
+    c3->head = nxt;
+  } else {
+    c3->nxt_buf[prv] = nxt;
+  }
+
+  if (_C3_NIL == nxt) {
+    c3->tail = prv;
+  } else {
+    c3->prv_buf[nxt] = prv;
+  }
+}
+
+static void _cache_c3_lru_push (
+  _InOut struct cache_c3_t * c3,
+  _In    u_word_t            lini
+)
+{
+  c3->prv_buf[lini] = _C3_NIL;
+  c3->nxt_buf[lini] = c3->head;
+
+  if (_C3_NIL == c3->head) {
+    c3->tail = lini;
+  } else {
+    c3->prv_buf[c3->head] = lini;
+  }
+
+  c3->head = lini;
+}
+
+/* CACHE_SUCCESS on a shadow hit; the line ends up most recently used */
+
+static int _cache_c3_lru_access (
+  _InOut struct cache_c3_t * c3,
+  _In    u_long_t            lin
+)
+{
+  u_long_t hidx = _cache_c3_map_find(c3, lin);
+  u_word_t lini;
+
+  if (_C3_EMPTY != c3->map_key[hidx]) {
+    lini = c3->map_val[hidx];
+
+    if (lini != c3->head) {
+      _cache_c3_lru_unlink(c3, lini);
+      _cache_c3_lru_push(c3, lini);
+    }
+
+    return CACHE_SUCCESS;
+  }
+
+  if (c3->usec < c3->linc) {
+    lini = c3->usec++;
+  } else {
+    lini = c3->tail;
+
+    _cache_c3_map_del(c3, _cache_c3_map_find(c3, c3->lin_buf[lini]));
+    _cache_c3_lru_unlink(c3, lini);
+
+    hidx = _cache_c3_map_find(c3, lin);
+  }
+
+  c3->lin_buf[lini] = lin;
+  c3->map_key[hidx] = lin;
+  c3->map_val[hidx] = lini;
+  _cache_c3_lru_push(c3, lini);
+
+  return CACHE_FAILURE;
+}
+
+struct cache_c3_t * cache_c3_ctor (
+  _InOut struct cache_c3_t * c3,
+  _InOut struct cache_t *    cache
+)
+{
+  if (!cache || cache->c3 || cache_get_cc(cache))
+    return NULL;
+
+  u_long_t linc = (u_long_t)cache->smpc * cache->wayc;
+
+  if (!linc || U_WORD_MAX <= linc)
+    return NULL;
+
+  if (!c3) {
+    c3 = (struct cache_c3_t *)malloc(sizeof(struct cache_c3_t));
+
+    if (!c3)
+      return c3;
+
+    c3->sr = 0;
+    cache_c3_set_ho(c3);
+  } else {
+    c3->sr = 0;
+  }
+
+  c3->cache   = cache;
+  c3->see_buf = NULL;
+  c3->linc    = (u_word_t)linc;
+  c3->mapz    = U_WORD(1);
+
+  while ((U_LONG(1) << c3->mapz) < U_LONG(2) * linc) {
+    ++c3->mapz;
+  }
+
+  c3->mapm    = (U_LONG(1) << c3->mapz) - U_LONG(1);
+  c3->lin_buf = (u_long_t *)malloc(linc * sizeof(u_long_t));
+  c3->prv_buf = (u_word_t *)malloc(linc * sizeof(u_word_t));
+  c3->nxt_buf = (u_word_t *)malloc(linc * sizeof(u_word_t));
+  c3->map_key = (u_long_t *)malloc((c3->mapm + 1) * sizeof(u_long_t));
+  c3->map_val = (u_word_t *)malloc((c3->mapm + 1) * sizeof(u_word_t));
+  c3->setv    = (struct cache_c3_cnt_t *)malloc(
+    cache->smpc * sizeof(struct cache_c3_cnt_t)
+  );
+
+  if (
+    !c3->lin_buf || !c3->prv_buf || !c3->nxt_buf ||
+    !c3->map_key || !c3->map_val || !c3->setv    ||
+    _cache_c3_see_init(c3, c3->mapz)
+  ) {
+    c3 = cache_c3_dtor(c3);
+    return NULL;
+  }
+
+  cache_c3_reset(c3);
+  cache->c3 = c3;
+
+  return c3;
+}
+
+struct cache_c3_t * cache_c3_dtor (
+  _InOut struct cache_c3_t * c3
+)
+{
+  if (!c3)
+    return c3;
+
+  if (c3->cache && c3->cache->c3 == c3) {
+    c3->cache->c3 = NULL;
+  }
+
+  free(c3->see_buf);
+  c3->see_buf = NULL;
+  free(c3->lin_buf);
+  c3->lin_buf = NULL;
+  free(c3->prv_buf);
+  c3->prv_buf = NULL;
+  free(c3->nxt_buf);
+  c3->nxt_buf = NULL;
+  free(c3->map_key);
+  c3->map_key = NULL;
+  free(c3->map_val);
+  c3->map_val = NULL;
+  free(c3->setv);
+  c3->setv = NULL;
+
+  if (cache_c3_get_ho(c3)) {
+    free(c3);
+    c3 = NULL;
+  }
+
+  return c3;
+}
+
+void cache_c3_detach (
+  _InOut struct cache_c3_t * c3
+)
+{
+  c3->cache = NULL;
+}
+
+void cache_c3_reset (
+  _InOut struct cache_c3_t * c3
+)
+{
+  memset(c3->see_buf, 0xFF, (c3->seem + 1) * sizeof(u_long_t));
+  memset(c3->map_key, 0xFF, (c3->mapm + 1) * sizeof(u_long_t));
+  memset(c3->setv, 0, c3->cache->smpc * sizeof(struct cache_c3_cnt_t));
+  memset(&c3->tot, 0, sizeof(c3->tot));
+
+  c3->seec = U_LONG(0);
+  c3->usec = U_WORD(0);
+  c3->head = _C3_NIL;
+  c3->tail = _C3_NIL;
+}
+
+void cache_c3_put (
+  _InOut struct cache_c3_t * c3,
+  _In    u_word_t            type,
+  _In    u_long_t            adr,
+  _In    u_word_t            seti
+)
+{
+  struct cache_c3_cnt_t * cnt = c3->setv + seti;
+
+  u_long_t lin  = adr >> c3->cache->sets;
+  u_long_t sidx = _cache_c3_see_find(c3, lin);
+  int      new  = _C3_EMPTY == c3->see_buf[sidx];
+  int      hit  = CACHE_SUCCESS == _cache_c3_lru_access(c3, lin);
+
+  /* if the set cannot grow, keep one slot free so that probes end */
+
+  if (new && c3->seec < c3->seem) {
+    c3->see_buf[sidx] = lin;
+
+    if (c3->seem < ++c3->seec * U_LONG(2)) {
+      _cache_c3_see_grow(c3);
+    }
+  }
+
+  ++cnt->accc;
+  ++c3->tot.accc;
+
+  if (CACHE_EVT_RD_MISS != type && CACHE_EVT_WR_MISS != type)
+    return;
+
+  if (new) {
+    ++cnt->cmpc;
+    ++c3->tot.cmpc;
+  } else if (!hit) {
+    ++cnt->capc;
+    ++c3->tot.capc;
+  } else {
+    ++cnt->cnfc;
+    ++c3->tot.cnfc;
+  }
+}
+
+void cache_c3_set (
+  _In    const struct cache_c3_t * c3,
+  _In    u_word_t                  seti,
+  _Out   struct cache_c3_cnt_t *   cnt
+)
+{
+  const struct cache_t * cache = c3->cache;
+
+  if (cache->setc <= seti || !cache_set_sampled(cache, seti)) {
+    memset(cnt, 0, sizeof(*cnt));
+    return;
+  }
+
+  *cnt = c3->setv[cache_set_stored(cache, seti)];
+}
+
+static void _cache_c3_print_cnt (
+  _In    const struct cache_c3_cnt_t * cnt,
+  _Out   FILE *                        fp
+)
+{
+  u_long_t misc = cnt->cmpc + cnt->capc + cnt->cnfc;
+
+  fprintf(
+    fp,
+    " %12" U_LONG_FMTD " %12" U_LONG_FMTD
+    " %12" U_LONG_FMTD " %12" U_LONG_FMTD " %12" U_LONG_FMTD "\n",
+    cnt->accc, misc, cnt->cmpc, cnt->capc, cnt->cnfc
+  );
+}
+
+void cache_c3_print (
+  _In    const struct cache_c3_t * c3,
+  _Out   FILE *                    fp
+)
+{
+  const struct cache_t * cache = c3->cache;
+
+  const struct cache_c3_cnt_t * tot = &c3->tot;
+
+  u_long_t misc = tot->cmpc + tot->capc + tot->cnfc;
+  u_word_t seti;
+
+  fprintf(
+    fp,
+    "3C MISSES (%" U_WORD_FMTD " LINE SHADOW)\n"
+    "| COMPULSORY %12" U_LONG_FMTD " %9.6f\n"
+    "| CAPACITY   %12" U_LONG_FMTD " %9.6f\n"
+    "| CONFLICT   %12" U_LONG_FMTD " %9.6f\n"
+    "| %8s %12s %12s %12s %12s %12s\n",
+    c3->linc,
+    tot->cmpc, misc ? (double)tot->cmpc / (double)misc : 0.0,
+    tot->capc, misc ? (double)tot->capc / (double)misc : 0.0,
+    tot->cnfc, misc ? (double)tot->cnfc / (double)misc : 0.0,
+    "SET", "ACCESSES", "MISSES", "COMPULSORY", "CAPACITY", "CONFLICT"
+  );
+
+  for (seti = U_WORD(0); seti < cache->smpc; ++seti) {
+    const struct cache_c3_cnt_t * cnt = c3->setv + seti;
+
+    if (!(cnt->cmpc | cnt->capc | cnt->cnfc))
+      continue;
+
+    fprintf(fp, "| %8" U_WORD_FMTD, cache_set_logical(cache, seti));
+    _cache_c3_print_cnt(cnt, fp);
+  }
+
+  fprintf(fp, "| ALL     ");
+  _cache_c3_print_cnt(tot, fp);
+}
@@ -0,0 +1,85 @@
+# ifndef __C3_H
+#   define __C3_H
+
+#   include "cache.h"
+
+/*
+ * 3C miss classification. Once attached to a cache the analyzer sees every
+ * read and write and sorts each miss into one of three kinds:
+ *
+ *   compulsory - first reference to the line,
+ *   capacity   - also a miss in a fully associative LRU cache with as many
+ *                lines as the modeled sets hold,
+ *   conflict   - any other miss, that is one more ways would have avoided.
+ *
+ * First-touch lines live in a growing open addressing set; the shadow cache
+ * is an open addressing map into an intrusive LRU list, so every access
+ * costs O(1). With sampling only the sampled sets are seen and the shadow
+ * holds as many lines as they do. Concurrent mode is not supported. Once
+ * `cache_dtor` has detached the analyzer only `cache_c3_dtor` is left.
+ */
+
+struct cache_c3_cnt_t {
+  u_long_t accc;
+  u_long_t cmpc; /* compulsory misses */
+  u_long_t capc; /* capacity misses   */
+  u_long_t cnfc; /* conflict misses   */
+};
+
+struct cache_c3_t {
+  u_word_t                sr;
+  struct cache_t *        cache;
+  u_word_t                seez;    /* in bits  */
+  u_long_t                seem;
+  u_long_t                seec;    /* in lines */
+  u_long_t *              see_buf;
+  u_word_t                linc;    /* in lines */
+  u_word_t                usec;    /* in lines */
+  u_word_t                head;    /* most recently used  */
+  u_word_t                tail;    /* least recently used */
+  u_long_t *              lin_buf;
+  u_word_t *              prv_buf;
+  u_word_t *              nxt_buf;
+  u_word_t                mapz;    /* in bits  */
+  u_long_t                mapm;
+  u_long_t *              map_key;
+  u_word_t *              map_val;
+  struct cache_c3_cnt_t * setv;    /* per stored set */
+  struct cache_c3_cnt_t   tot;
+};
+
+#   define cache_c3_clr_ho(c3) (c3)->sr &= ~0x1
+#   define cache_c3_set_ho(c3) (c3)->sr |= 0x1
+#   define cache_c3_get_ho(c3) ((c3)->sr & 0x1)
+
+struct cache_c3_t * cache_c3_ctor (
+  _InOut struct cache_c3_t * c3,
+  _InOut struct cache_t *    cache
+);
+
+struct cache_c3_t * cache_c3_dtor (
+  _InOut struct cache_c3_t * c3
+);
+
+/* forget every line and count, e.g. together with `cache_reset` */
+
+void cache_c3_reset (
+  _InOut struct cache_c3_t * c3
+);
+
+/* the breakdown of logical set `seti`, all zero for an unsampled set */
+
+void cache_c3_set (
+  _In    const struct cache_c3_t * c3,
+  _In    u_word_t                  seti,
+  _Out   struct cache_c3_cnt_t *   cnt
+);
+
+/* overall breakdown, then one line per set that missed */
+
+void cache_c3_print (
+  _In    const struct cache_c3_t * c3,
+  _Out   FILE *                    fp
+);
+
+# endif
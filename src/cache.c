@@ -2,6 +2,34 @@
 # include <stdlib.h>
 # include <stdarg.h>
 # include <string.h>
+# include <math.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+static void _cache_aux_dtor (
+  _InOut struct cache_t * cache
+);
+
+static int _cache_aux_ctor (
+  _InOut struct cache_t * cache
+);
+
+static u_long_t _cache_pk_stride (
+  _In    u_word_t wayc,
+  _In    u_word_t pkb
+);
+
+static int _cache_geom_check (
+  _In    u_word_t setc,
+  _In    u_word_t datc,
+  _In    u_word_t tags,
+  _In    u_word_t sets,
+  _In    u_word_t dats,
+  _In    u_word_t tagz,
+  _In    u_word_t hdrc
+);
 
 struct cache_t * cache_ctor (
   _InOut struct cache_t * cache,
@@ -17,6 +45,8 @@ struct cache_t * cache_ctor (
     if (!cache)
       return cache;
 
+    memset(cache, 0, sizeof(struct cache_t));
+
     cache->sr      = 0;
     cache->dat_buf = NULL;
     cache->hdr_buf = NULL;
@@ -25,6 +55,40 @@ struct cache_t * cache_ctor (
     cache->sr = 0;
   }
 
+  cache->map_len = U_LONG(0);
+  cache->map_buf = NULL;
+  cache->seq_buf = NULL;
+  cache->cnt_buf = NULL;
+  cache->smp_buf = NULL;
+  cache->wpr_buf = NULL;
+  cache->ptg_buf = NULL;
+  cache->vld_buf = NULL;
+  cache->pin_buf = NULL;
+  cache->upk_buf = NULL;
+  cache->pinc    = U_LONG(0);
+  cache->rqc     = U_WORD(0);
+  cache->rqi     = U_WORD(0);
+  cache->wmsk    = ~U_LONG(0);
+  cache->own_buf = NULL;
+  cache->rq_buf  = NULL;
+  cache->evt     = NULL;
+  cache->c3      = NULL;
+  cache->rd_hitc = U_LONG(0);
+  cache->rd_misc = U_LONG(0);
+  cache->wr_hitc = U_LONG(0);
+  cache->wr_misc = U_LONG(0);
+  cache->skpc    = U_LONG(0);
+  cache->wp_hitc = U_LONG(0);
+  cache->wp_misc = U_LONG(0);
+  cache->wp_prbc = U_LONG(0);
+  cache->rnd     = U_LONG(0);
+
+  /* the geometry, kept to resize its tag for `--sets` */
+
+  u_word_t adrz = U_WORD(0);
+  u_word_t hdrz = U_WORD(0);
+  u_word_t setn = U_WORD(0);
+
   for (int argi = 0; argi < argc; ++argi) {
     char * args = argv[argi];
 
@@ -41,8 +105,21 @@ struct cache_t * cache_ctor (
         "  -h, --help            --- Print the help page.\n"
         "  -v, --version         --- Print the version.\n"
         "  -g, --geom   GEOMETRY --- Set the cache geometry.\n"
+        "  -s, --sets   COUNT    --- Use COUNT sets instead of 1 << SETZ.\n"
+        "  -i, --index  FUNCTION --- Set the set index function.\n"
         "  -f, --flush  METHOD   --- Set the cache flush method.\n"
         "  -p, --policy METHODS  --- Set the cache policy methods.\n"
+        "  -t, --tags-only       --- Keep no line data.\n"
+        "  -k, --packed          --- Bit-pack the way headers.\n"
+        "  -r, --seed   SEED     --- Seed the random policy.\n"
+        "\n"
+        "geometry: ADRZ:SETZ:WAYC:DATZ[:HDRZ]\n"
+        "  address bits, set index bits, ways, line offset bits and\n"
+        "  extra header bits, e.g. 48:10:16:6 for a 1 MiB cache.\n"
+        "  A set count that is not a power of two needs prime indexing.\n"
+        "index functions: bits (default), xor, prime, skew[:BANKS]\n"
+        "flush methods:   none (default), print\n"
+        "policy methods:  lru (default), plru, random\n"
         "\n"
       );
 
@@ -74,338 +151,3272 @@ struct cache_t * cache_ctor (
       0 == strcmp(args, "-g")     ||
       0 == strcmp(args, "--geom")
     ) {
-      u_word_t hdrz, adrz, setz, datz;
-
-      /* TODO: extract information */
+      u_word_t setz, wayc, datz;
+      int      len  = 0;
+
+      hdrz = U_WORD(0);
+
+      int res = argi + 1 < argc ? sscanf(
+        argv[++argi],
+        "%" SCNu32 ":%" SCNu32 ":%" SCNu32 ":%" SCNu32 "%n:%" SCNu32 "%n",
+        &adrz, &setz, &wayc, &datz, &len, &hdrz, &len
+      ) : 0;
+
+      /* the tag is shifted by its size, the way buffers sized in words */
+
+      if (
+        res < 4                              ||
+        argv[argi][len]                      ||
+        !wayc || U_HALF_MAX < wayc           ||
+        U_HALF_MAX < hdrz                    ||
+        32 <= setz || 32 <= datz             ||
+        64 <  adrz                           ||
+        adrz <= setz + datz                  ||
+        64 <= adrz - setz - datz             ||
+        U_WORD_MAX < ((u_long_t)wayc << datz)
+      ) {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
 
       cache->dats = 0;
       cache->sets = datz;
       cache->tags = setz + datz;
       cache->setc = U_WORD(1) << setz;
+      cache->wayc = wayc;
       cache->datc = U_WORD(1) << datz;
       cache->tagz = adrz - cache->tags;
-      hdrz += cache->tagz + U_WORD(8);
-      cache->hdrc = u_round_up(hdrz, U_WORD(8));
+      cache->hdrc = u_round_up(hdrz + cache->tagz + U_WORD(8), U_WORD(8));
+    } else if (
+      0 == strcmp(args, "-s")     ||
+      0 == strcmp(args, "--sets")
+    ) {
+      int len = 0;
+
+      if (
+        argi + 1 >= argc                                          ||
+        1 != sscanf(argv[++argi], "%" SCNu32 "%n", &setn, &len)   ||
+        argv[argi][len] || !setn || U_WORD(1) << 31 < setn
+      ) {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
+    } else if (
+      0 == strcmp(args, "-i")      ||
+      0 == strcmp(args, "--index")
+    ) {
+      char * func = argi + 1 < argc ? argv[++argi] : "";
+      int    len  = 0;
+
+      if (0 == strcmp(func, "bits")) {
+        cache->idxf = CACHE_INDEX_BITS;
+      } else if (0 == strcmp(func, "xor")) {
+        cache->idxf = CACHE_INDEX_XOR;
+      } else if (0 == strcmp(func, "prime")) {
+        cache->idxf = CACHE_INDEX_PRIME;
+      } else if (0 == strcmp(func, "skew")) {
+        cache->idxf = CACHE_INDEX_SKEW;
+        cache->bnkc = U_WORD(0);
+      } else if (
+        1 == sscanf(func, "skew:%" SCNu32 "%n", &cache->bnkc, &len) &&
+        !func[len] && cache->bnkc
+      ) {
+        cache->idxf = CACHE_INDEX_SKEW;
+      } else {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
     } else if (
       0 == strcmp(args, "-f")      ||
       0 == strcmp(args, "--flush")
     ) {
-      /* TODO: extract information */
+      char * meth = argi + 1 < argc ? argv[++argi] : "";
+
+      if (0 == strcmp(meth, "none")) {
+        cache->flush = cache_flush_none;
+      } else if (0 == strcmp(meth, "print")) {
+        cache->flush = cache_flush_print;
+      } else {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
     } else if (
       0 == strcmp(args, "-p")      ||
       0 == strcmp(args, "--policy")
     ) {
-      /* TODO: extract information */
+      char * meth = argi + 1 < argc ? argv[++argi] : "";
+
+      if (0 == strcmp(meth, "lru")) {
+        cache->rp_reset = cache_rp_lru_reset;
+        cache->rp_set   = cache_rp_lru_set;
+        cache->rp_get   = cache_rp_lru_get;
+      } else if (0 == strcmp(meth, "plru")) {
+        cache->rp_reset = cache_rp_plru_reset;
+        cache->rp_set   = cache_rp_plru_set;
+        cache->rp_get   = cache_rp_plru_get;
+      } else if (0 == strcmp(meth, "random")) {
+        cache->rp_reset = cache_rp_random_reset;
+        cache->rp_set   = cache_rp_random_set;
+        cache->rp_get   = cache_rp_random_get;
+      } else {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
+    } else if (
+      0 == strcmp(args, "-t")         ||
+      0 == strcmp(args, "--tags-only")
+    ) {
+      cache_set_to(cache);
+    } else if (
+      0 == strcmp(args, "-k")      ||
+      0 == strcmp(args, "--packed")
+    ) {
+      cache_set_ph(cache);
+    } else if (
+      0 == strcmp(args, "-r")    ||
+      0 == strcmp(args, "--seed")
+    ) {
+      int len = 0;
+
+      if (
+        argi + 1 >= argc                                             ||
+        1 != sscanf(argv[++argi], "%" SCNu64 "%n", &cache->rnd, &len) ||
+        argv[argi][len]
+      ) {
+        cache = cache_dtor(cache);
+        return NULL;
+      }
+    }
+  }
+
+  /*
+   * Any other set count keeps the geometry's address and header bits. The
+   * quotient kept as the tag by prime indexing then takes up to one more
+   * bit than the address above the set index.
+   */
+
+  if (setn) {
+    u_word_t idxz;
+
+    for (idxz = U_WORD(0); idxz < 32; ++idxz) {
+      if (setn <= U_WORD(1) << idxz)
+        break;
+    }
+
+    u_word_t tagx = setn & (setn - U_WORD(1)) ? U_WORD(1) : U_WORD(0);
+
+    if (!adrz || adrz + tagx < cache->sets + idxz + U_WORD(1)) {
+      cache = cache_dtor(cache);
+      return NULL;
     }
+
+    cache->setc = setn;
+    cache->tags = cache->sets + idxz;
+    cache->tagz = adrz + tagx - cache->tags;
+    cache->hdrc = u_round_up(hdrz + cache->tagz + U_WORD(8), U_WORD(8));
+  }
+
+  /* without a method the cache replaces LRU ways and flushes nothing */
+
+  if (!cache->rp_reset && !cache->rp_set && !cache->rp_get) {
+    cache->rp_reset = cache_rp_lru_reset;
+    cache->rp_set   = cache_rp_lru_set;
+    cache->rp_get   = cache_rp_lru_get;
+  }
+
+  if (!cache->flush) {
+    cache->flush = cache_flush_none;
+  }
+
+  if (
+    !cache->rp_reset || !cache->rp_set || !cache->rp_get               ||
+    !cache->setc || !cache->wayc || !cache->datc                       ||
+    64 <= cache->tagz || 32 <= cache->smpz                             ||
+    _cache_geom_check(
+      cache->setc, cache->datc,
+      cache->tags, cache->sets, cache->dats,
+      cache->tagz, cache->hdrc
+    )                                                                  ||
+    (cache_rp_lru_set  == cache->rp_set && CACHE_RP_MAX < cache->wayc) ||
+    (
+      cache_rp_plru_set == cache->rp_set &&
+      cache->wayc & (cache->wayc - U_WORD(1))
+    )
+  ) {
+    cache = cache_dtor(cache);
+    return NULL;
   }
 
   cache->tagm    = (U_LONG(1) << cache->tagz) - U_LONG(1);
   cache->setm    = cache->setc - U_WORD(1);
   cache->datm    = cache->datc - U_WORD(1);
-  cache->dat_len = cache->wayc * cache->datc;
-  cache->hdr_len = cache->wayc * cache->hdrc;
-  cache->tot_len = cache->setc * (
-    cache->dat_len + cache->hdr_len
+  cache->smpm    = (U_WORD(1) << cache->smpz) - U_WORD(1);
+  cache->smpc    = (cache->setc + cache->smpm - cache->smpo) >> cache->smpz;
+
+  if (!cache->bnkc || CACHE_INDEX_SKEW != cache->idxf) {
+    cache->bnkc = cache->wayc;
+  }
+
+  for (cache->idxz = U_WORD(0); cache->idxz < 32; ++cache->idxz) {
+    if (cache->setc <= U_WORD(1) << cache->idxz)
+      break;
+  }
+
+  if (cache->secc < U_WORD(2)) {
+    cache->secc = U_WORD(1);
+    cache->secb = U_WORD(0);
+    cache->datb = U_WORD(0);
+  } else {
+    cache->secb = u_round_up(cache->secc, U_WORD(8));
+    cache->datb = u_round_up(cache->datc, U_WORD(8));
+  }
+
+  for (cache->secs = U_WORD(0); cache->secs < 32; ++cache->secs) {
+    if (cache->datc == cache->secc << cache->secs)
+      break;
+  }
+
+  /* buffer lengths are sized in 64 bits, then must fit their word fields */
+
+  u_long_t dat_len = cache_get_to(cache) ? U_LONG(0) : (
+    (u_long_t)cache->wayc * cache->datc
+  );
+  u_long_t hdr_len;
+  u_long_t pkz;
+  u_long_t hdr_off;
+  u_long_t tot_len;
+
+  cache->secp    = cache->hdrc;
+  cache->hdrc   += U_WORD(2) * cache->secb + cache->datb;
+  hdr_len        = (u_long_t)cache->wayc * cache->hdrc;
+  cache->dat_len = (u_word_t)dat_len;
+  cache->hdr_len = (u_word_t)hdr_len;
+
+  /* policy bits of a packed way: what the built-in policies store */
+
+  if (!cache_get_ph(cache)) {
+    cache->rpb = U_WORD(0);
+  } else if (cache_rp_lru_set == cache->rp_set) {
+    for (cache->rpb = U_WORD(0); cache->rpb < 6; ++cache->rpb) {
+      if (cache->wayc <= U_WORD(1) << cache->rpb)
+        break;
+    }
+  } else if (cache_rp_plru_set == cache->rp_set) {
+    cache->rpb = U_WORD(1);
+  } else if (cache_rp_random_set == cache->rp_set) {
+    cache->rpb = U_WORD(0);
+  } else {
+    cache->rpb = U_WORD(6);
+  }
+
+  cache->pkb = cache_get_ph(cache) ? (
+    U_WORD(2) + cache->rpb + cache->tagz
+  ) : U_WORD(0);
+  pkz        = cache->pkb ? _cache_pk_stride(cache->wayc, cache->pkb) : (
+    hdr_len
+  );
+  cache->pkz = (u_word_t)pkz;
+
+  /* packed sets start on a host cache line */
+
+  hdr_off = (u_long_t)cache->smpc * dat_len;
+
+  if (cache_get_ph(cache)) {
+    hdr_off = u_round_up(hdr_off, U_LONG(64)) * U_LONG(64);
+  }
+
+  tot_len = hdr_off + (u_long_t)cache->smpc * pkz;
+
+  if (
+    U_WORD_MAX - U_WORD(64) < tot_len ||
+    !cache->smpc                     ||
+    cache->smpm < cache->smpo        ||
+    cache->secs == 32                ||
+    cache->secc & (cache->secc - 1)  ||
+    CACHE_INDEX_SKEW < cache->idxf   ||
+    cache->wayc % cache->bnkc        ||
+    (
+      CACHE_INDEX_PRIME != cache->idxf &&
+      cache->setc & cache->setm
+    )                                ||
+    (
+      CACHE_INDEX_SKEW == cache->idxf &&
+      (
+        cache->smpz         ||
+        cache_get_cc(cache) ||
+        cache_get_wp(cache) ||
+        cache_get_pt(cache)
+      )
+    )                                ||
+    (
+      cache_get_ph(cache) &&
+      (
+        cache->secc > U_WORD(1)                          ||
+        cache->hdrc != u_round_up(cache->tagz + 8, 8)    ||
+        cache_get_cc(cache)
+      )
+    )
+  ) {
+    cache = cache_dtor(cache);
+    return NULL;
+  }
+
+  cache->tot_len = (u_word_t)tot_len;
+
+  if (!cache->dat_buf && (cache->dat_len || !cache->hdr_buf)) {
+    u_word_t len = cache->hdr_buf ? cache->smpc * cache->dat_len : (
+      cache->tot_len
+    );
+
+    cache->dat_buf = (u_byte_t *)(
+      cache_get_ph(cache) ?
+      aligned_alloc(64, u_round_up(len, U_WORD(64)) * U_WORD(64)) :
+      malloc(len)
+    );
+
+    if (!cache->dat_buf) {
+      cache = cache_dtor(cache);
+      return NULL;
+    }
+
+    cache_set_hm(cache);
+  }
+
+  if (!cache->hdr_buf) {
+    cache->hdr_buf = cache->dat_buf + hdr_off;
+
+    cache_set_sm(cache);
+  }
+
+  if (_cache_aux_ctor(cache)) {
+    cache = cache_dtor(cache);
+    return NULL;
+  }
+
+  return cache;
+}
+
+/* everything `cache` owns but the structure itself */
+
+static void _cache_release (
+  _InOut struct cache_t * cache
+)
+{
+  if (cache->evt) {
+    cache_evt_detach(cache->evt);
+    cache->evt = NULL;
+  }
+
+  if (cache->c3) {
+    cache_c3_detach(cache->c3);
+    cache->c3 = NULL;
+  }
+
+  _cache_aux_dtor(cache);
+
+  if (cache_get_mm(cache)) {
+    munmap(cache->map_buf, cache->map_len);
+    cache->map_buf = NULL;
+    cache->map_len = U_LONG(0);
+    cache->dat_buf = NULL;
+    cache->hdr_buf = NULL;
+  }
+
+  if (cache_get_hm(cache)) {
+    if (cache->dat_buf) {
+      free(cache->dat_buf);
+      cache->dat_buf = NULL;
+    }
+
+    if (cache_get_sm(cache)) {
+      cache->hdr_buf = NULL;
+    }
+  }
+}
+
+struct cache_t * cache_dtor (
+  _InOut struct cache_t * cache
+)
+{
+  if (!cache)
+    return cache;
+
+  _cache_release(cache);
+
+  if (cache_get_ho(cache)) {
+    free(cache);
+    cache = NULL;
+  }
+
+  return cache;
+}
+
+struct _cache_ckpt_t {
+  char     magic [8];
+  u_word_t version;
+  u_word_t cache_version;
+  u_long_t dat_off;  /* in bytes */
+  u_long_t dat_size; /* in bytes */
+  u_long_t hdr_off;  /* in bytes */
+  u_long_t hdr_size; /* in bytes */
+  u_long_t tagm;
+  u_word_t setm;
+  u_word_t datm;
+  u_word_t tags;
+  u_word_t sets;
+  u_word_t dats;
+  u_word_t setc;
+  u_word_t wayc;
+  u_word_t datc;
+  u_word_t tagz;
+  u_word_t hdrc;
+  u_word_t smpz;
+  u_word_t smpo;
+  u_word_t secc;
+  u_word_t secp;
+  u_word_t idxf;
+  u_word_t bnkc;
+  u_word_t pkb;
+};
+
+static int _cache_ckpt_write (
+  _In    int              fd,
+  _In    const u_byte_t * buf,
+  _In    u_long_t         len
+)
+{
+  while (len) {
+    ssize_t res = write(fd, buf, len);
+
+    if (res <= 0)
+      return CACHE_FAILURE;
+
+    buf += res;
+    len -= (u_long_t)res;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+int cache_save (
+  _In    struct cache_t * cache,
+  _In    const char *     path
+)
+{
+  if (cache_get_wr(cache) || cache_get_wf(cache))
+    return CACHE_WAITING;
+
+  struct _cache_ckpt_t ckpt;
+  memset(&ckpt, 0, sizeof(ckpt));
+
+  u_long_t page = (u_long_t)sysconf(_SC_PAGESIZE);
+
+  memcpy(ckpt.magic, CACHE_CKPT_MAGIC, sizeof(CACHE_CKPT_MAGIC));
+  ckpt.version       = CACHE_CKPT_VERSION;
+  ckpt.cache_version = __CACHE_VERSION;
+  ckpt.dat_off       = u_round_up(sizeof(ckpt), page) * page;
+  ckpt.dat_size      = (u_long_t)cache->smpc * cache->dat_len;
+  ckpt.hdr_off       = u_round_up(ckpt.dat_off + ckpt.dat_size, 64) * 64;
+  ckpt.hdr_size      = (u_long_t)cache->smpc * cache->pkz;
+  ckpt.tagm          = cache->tagm;
+  ckpt.setm          = cache->setm;
+  ckpt.datm          = cache->datm;
+  ckpt.tags          = cache->tags;
+  ckpt.sets          = cache->sets;
+  ckpt.dats          = cache->dats;
+  ckpt.setc          = cache->setc;
+  ckpt.wayc          = cache->wayc;
+  ckpt.datc          = cache->datc;
+  ckpt.tagz          = cache->tagz;
+  ckpt.hdrc          = cache->hdrc;
+  ckpt.smpz          = cache->smpz;
+  ckpt.smpo          = cache->smpo;
+  ckpt.secc          = cache->secc;
+  ckpt.secp          = cache->secp;
+  ckpt.idxf          = cache->idxf;
+  ckpt.bnkc          = cache->bnkc;
+  ckpt.pkb           = cache->pkb;
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0)
+    return CACHE_FAILURE;
+
+  int res = _cache_ckpt_write(fd, (const u_byte_t *)&ckpt, sizeof(ckpt));
+
+  if (!res && ftruncate(fd, (off_t)ckpt.dat_off))
+    res = CACHE_FAILURE;
+
+  if (!res && ckpt.dat_off != (u_long_t)lseek(fd, (off_t)ckpt.dat_off, SEEK_SET))
+    res = CACHE_FAILURE;
+
+  if (!res)
+    res = _cache_ckpt_write(fd, cache->dat_buf, ckpt.dat_size);
+
+  if (!res && ckpt.hdr_off != (u_long_t)lseek(fd, (off_t)ckpt.hdr_off, SEEK_SET))
+    res = CACHE_FAILURE;
+
+  if (!res)
+    res = _cache_ckpt_write(fd, cache->hdr_buf, ckpt.hdr_size);
+
+  if (close(fd))
+    res = CACHE_FAILURE;
+
+  return res;
+}
+
+struct cache_t * cache_load (
+  _InOut struct cache_t * cache,
+  _In    const char *     path
+)
+{
+  struct _cache_ckpt_t ckpt;
+  struct stat          st;
+
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+
+  if (
+    fstat(fd, &st) ||
+    sizeof(ckpt) != (size_t)pread(fd, &ckpt, sizeof(ckpt), 0)
+  ) {
+    close(fd);
+    return NULL;
+  }
+
+  u_word_t smpc = ckpt.smpz < 32 ? (
+    ckpt.setc + ((U_WORD(1) << ckpt.smpz) - U_WORD(1)) - ckpt.smpo
+  ) >> ckpt.smpz : U_WORD(0);
+
+  if (
+    memcmp(ckpt.magic, CACHE_CKPT_MAGIC, sizeof(CACHE_CKPT_MAGIC)) ||
+    CACHE_CKPT_VERSION != ckpt.version                            ||
+    ckpt.smpz     >= 32                                           ||
+    ckpt.tagz     >= 64                                           ||
+    !ckpt.setc || !ckpt.wayc || !ckpt.datc                        ||
+    _cache_geom_check(
+      ckpt.setc, ckpt.datc,
+      ckpt.tags, ckpt.sets, ckpt.dats,
+      ckpt.tagz, ckpt.secp
+    )                                                             ||
+    (ckpt.pkb && ckpt.hdrc != u_round_up(ckpt.tagz + 8, 8))       ||
+    ckpt.secc     <  1 || ckpt.datc % ckpt.secc                   ||
+    ckpt.hdrc     != ckpt.secp + (
+      ckpt.secc < 2 ? 0 : (
+        2 * u_round_up(ckpt.secc, 8) + u_round_up(ckpt.datc, 8)
+      )
+    )                                                             ||
+    CACHE_INDEX_SKEW < ckpt.idxf                                  ||
+    !ckpt.bnkc || ckpt.wayc % ckpt.bnkc                           ||
+    ckpt.smpo     >> ckpt.smpz                                    ||
+    (
+      ckpt.dat_size &&
+      ckpt.dat_size != (u_long_t)smpc * ckpt.wayc * ckpt.datc
+    )                                                             ||
+    (
+      ckpt.pkb &&
+      (ckpt.pkb < ckpt.tagz + 2 || ckpt.tagz + 8 < ckpt.pkb)
+    )                                                             ||
+    ckpt.hdr_size != (u_long_t)smpc * (
+      ckpt.pkb ? _cache_pk_stride(ckpt.wayc, ckpt.pkb) : (
+        (u_long_t)ckpt.wayc * ckpt.hdrc
+      )
+    )                                                             ||
+    ckpt.dat_off  <  sizeof(ckpt)                                 ||
+    ckpt.hdr_off != u_round_up(ckpt.dat_off + ckpt.dat_size, 64) * 64 ||
+    ckpt.hdr_off + ckpt.hdr_size  > (u_long_t)st.st_size          ||
+    ckpt.hdr_off - ckpt.dat_off + ckpt.hdr_size > U_WORD_MAX
+  ) {
+    close(fd);
+    return NULL;
+  }
+
+  u_byte_t * map_buf = (u_byte_t *)mmap(
+    NULL, (size_t)st.st_size,
+    PROT_READ | PROT_WRITE, MAP_PRIVATE,
+    fd, 0
+  );
+
+  close(fd);
+
+  if (MAP_FAILED == map_buf)
+    return NULL;
+
+  if (!cache) {
+    cache = (struct cache_t *)malloc(
+      sizeof(struct cache_t)
+    );
+
+    if (!cache) {
+      munmap(map_buf, (size_t)st.st_size);
+      return cache;
+    }
+
+    memset(cache, 0, sizeof(struct cache_t));
+
+    cache->sr = 0;
+    cache_set_ho(cache);
+  } else {
+    u_word_t ho = cache_get_ho(cache);
+
+    _cache_release(cache);
+
+    cache->sr = 0;
+
+    if (ho) {
+      cache_set_ho(cache);
+    }
+  }
+
+  cache->rd_hitc = U_LONG(0);
+  cache->rd_misc = U_LONG(0);
+  cache->wr_hitc = U_LONG(0);
+  cache->wr_misc = U_LONG(0);
+  cache->skpc    = U_LONG(0);
+  cache->wp_hitc = U_LONG(0);
+  cache->wp_misc = U_LONG(0);
+  cache->wp_prbc = U_LONG(0);
+  cache->rnd     = U_LONG(0);
+  cache->seq_buf = NULL;
+  cache->cnt_buf = NULL;
+  cache->smp_buf = NULL;
+  cache->wpr_buf = NULL;
+  cache->ptg_buf = NULL;
+  cache->vld_buf = NULL;
+  cache->pin_buf = NULL;
+  cache->upk_buf = NULL;
+  cache->pinc    = U_LONG(0);
+  cache->rqc     = U_WORD(0);
+  cache->rqi     = U_WORD(0);
+  cache->wmsk    = ~U_LONG(0);
+  cache->own_buf = NULL;
+  cache->rq_buf  = NULL;
+  cache->evt     = NULL;
+  cache->c3      = NULL;
+  cache->map_len = (u_long_t)st.st_size;
+  cache->map_buf = map_buf;
+  cache_set_mm(cache);
+
+  cache->tagm    = (U_LONG(1) << ckpt.tagz) - U_LONG(1);
+  cache->setm    = ckpt.setc - U_WORD(1);
+  cache->datm    = ckpt.datc - U_WORD(1);
+  cache->tags    = ckpt.tags;
+  cache->sets    = ckpt.sets;
+  cache->dats    = ckpt.dats;
+  cache->setc    = ckpt.setc;
+  cache->wayc    = ckpt.wayc;
+  cache->datc    = ckpt.datc;
+  cache->tagz    = ckpt.tagz;
+  cache->hdrc    = ckpt.hdrc;
+  cache->smpz    = ckpt.smpz;
+  cache->smpo    = ckpt.smpo;
+  cache->smpm    = (U_WORD(1) << cache->smpz) - U_WORD(1);
+  cache->smpc    = (cache->setc + cache->smpm - cache->smpo) >> cache->smpz;
+  cache->idxf    = ckpt.idxf;
+  cache->bnkc    = ckpt.bnkc;
+  cache->idxz    = U_WORD(0);
+
+  while (U_WORD(1) << cache->idxz < cache->setc) {
+    ++cache->idxz;
+  }
+
+  cache->secc    = ckpt.secc;
+  cache->secp    = ckpt.secp;
+  cache->secb    = ckpt.secc < 2 ? U_WORD(0) : u_round_up(ckpt.secc, 8);
+  cache->datb    = ckpt.secc < 2 ? U_WORD(0) : u_round_up(ckpt.datc, 8);
+  cache->secs    = U_WORD(0);
+
+  while (cache->secc << cache->secs < cache->datc) {
+    ++cache->secs;
+  }
+
+  /* a tag-only checkpoint has no data array */
+
+  if (ckpt.dat_size) {
+    cache_clr_to(cache);
+  } else {
+    cache_set_to(cache);
+  }
+
+  cache->dat_len = cache_get_to(cache) ? U_WORD(0) : (
+    cache->wayc * cache->datc
   );
+  cache->hdr_len = cache->wayc * cache->hdrc;
+
+  /* so is the header layout */
+
+  if (ckpt.pkb) {
+    cache_set_ph(cache);
+  } else {
+    cache_clr_ph(cache);
+  }
+
+  cache->pkb     = ckpt.pkb;
+  cache->rpb     = ckpt.pkb ? ckpt.pkb - U_WORD(2) - ckpt.tagz : U_WORD(0);
+  cache->pkz     = ckpt.pkb ? (
+    (u_word_t)_cache_pk_stride(cache->wayc, ckpt.pkb)
+  ) : cache->hdr_len;
+  cache->tot_len = (u_word_t)(ckpt.hdr_off - ckpt.dat_off + ckpt.hdr_size);
+  cache->dat_buf = map_buf + ckpt.dat_off;
+  cache->hdr_buf = map_buf + ckpt.hdr_off;
+
+  if (
+    (CACHE_INDEX_SKEW == cache->idxf && cache_get_cc(cache)) ||
+    (CACHE_INDEX_SKEW == cache->idxf && cache_get_wp(cache)) ||
+    (CACHE_INDEX_SKEW == cache->idxf && cache_get_pt(cache)) ||
+    (cache_get_ph(cache) && cache_get_cc(cache))             ||
+    _cache_aux_ctor(cache)
+  ) {
+    cache = cache_dtor(cache);
+    return NULL;
+  }
+
+  return cache;
+}
+
+/*
+ * Partial tags: one byte of tag hash per way, so a set can reject a miss
+ * with a word-wide compare of eight ways at a time before any full tag is
+ * decoded. Only a matching byte leads to a full tag comparison.
+ */
+
+static inline u_byte_t _cache_pt_hash (
+  _In    u_long_t tag
+)
+{
+  return (u_byte_t)((tag * U_LONG(0x9E3779B97F4A7C15)) >> 56);
+}
+
+static inline u_byte_t * _cache_pt_row (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti
+)
+{
+  if (!cache->ptg_buf)
+    return NULL;
+
+  return cache->ptg_buf + seti * cache->ptgz;
+}
+
+static int _cache_pt_any (
+  _In    const struct cache_t * cache,
+  _In    const u_byte_t *       ptg,
+  _In    u_byte_t               pt
+)
+{
+  const u_long_t lo = U_LONG(0x0101010101010101);
+  const u_long_t hi = U_LONG(0x8080808080808080);
+
+  if (!ptg)
+    return 1;
+
+  u_long_t rep = lo * pt;
+  u_word_t wayi;
+
+  for (wayi = U_WORD(0); wayi < cache->ptgz; wayi += U_WORD(8)) {
+    /* rows are word aligned */
+
+    u_long_t val = __atomic_load_n(
+      (const u_long_t *)(ptg + wayi), __ATOMIC_RELAXED
+    );
+
+    val ^= rep;
+
+    /* a zero byte is a match; the last word masks its padding ways */
+
+    u_long_t hit = (val - lo) & ~val & hi;
+
+    if (wayi + U_WORD(8) >= cache->ptgz) {
+      hit &= cache->ptgm;
+    }
+
+    if (hit)
+      return 1;
+  }
+
+  return 0;
+}
+
+static inline void _cache_pt_set (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi,
+  _In    u_long_t         tag
+)
+{
+  u_byte_t * ptg = _cache_pt_row(cache, seti);
+
+  if (ptg) {
+    ptg[wayi] = _cache_pt_hash(tag);
+  }
+}
+
+/*
+ * Packed headers: way `wayi` of a stored set takes the `pkb` bits from bit
+ * `wayi * pkb` of the set's `pkz` bytes, least significant first: valid,
+ * dirty, `rpb` policy bits, then the tag. A field is read or written with
+ * one unaligned 64-bit access, bytewise only at the very end of a set.
+ */
+
+/*
+ * A geometry must agree with itself: lines of `1 << (sets - dats)` bytes,
+ * the tag right above the set index, and a header with room for the status
+ * byte and the tag. `setc` may be any count, indexed with its rounded up
+ * number of bits.
+ */
+
+static int _cache_geom_check (
+  _In    u_word_t setc,
+  _In    u_word_t datc,
+  _In    u_word_t tags,
+  _In    u_word_t sets,
+  _In    u_word_t dats,
+  _In    u_word_t tagz,
+  _In    u_word_t hdrc
+)
+{
+  u_word_t idxz;
+
+  for (idxz = U_WORD(0); idxz < 32; ++idxz) {
+    if (setc <= U_WORD(1) << idxz)
+      break;
+  }
+
+  if (
+    sets < dats || 32 <= sets - dats               ||
+    datc != U_WORD(1) << (sets - dats)             ||
+    tags != sets + idxz                            ||
+    64 < (u_long_t)tags + tagz                     ||
+    hdrc < u_round_up(tagz + U_WORD(8), U_WORD(8))
+  ) {
+    return CACHE_FAILURE;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+static u_long_t _cache_pk_stride (
+  _In    u_word_t wayc,
+  _In    u_word_t pkb
+)
+{
+  u_long_t len = u_round_up((u_long_t)wayc * pkb, U_LONG(8));
+  u_long_t pkz = U_LONG(8);
+
+  if (U_LONG(64) < len)
+    return u_round_up(len, U_LONG(64)) * U_LONG(64);
+
+  while (pkz < len) {
+    pkz <<= 1;
+  }
+
+  return pkz;
+}
+
+static inline u_long_t _cache_le64 (
+  _In    u_long_t val
+)
+{
+# if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_bswap64(val);
+# else
+  return val;
+# endif
+}
+
+static u_long_t _cache_pk_get (
+  _In    const u_byte_t * set,
+  _In    u_word_t         pkz,
+  _In    u_word_t         bit,
+  _In    u_word_t         bitc
+)
+{
+  if (U_WORD(56) < bitc) {
+    return (
+      _cache_pk_get(set, pkz, bit, U_WORD(32)) |
+      _cache_pk_get(set, pkz, bit + U_WORD(32), bitc - U_WORD(32)) << 32
+    );
+  }
+
+  u_word_t byti = bit >> 3;
+  u_long_t val  = U_LONG(0);
+  u_word_t i;
+
+  if (byti + U_WORD(8) <= pkz) {
+    memcpy(&val, set + byti, sizeof(val));
+    val = _cache_le64(val);
+  } else {
+    for (i = byti; i < pkz; ++i) {
+      val |= (u_long_t)set[i] << ((i - byti) << 3);
+    }
+  }
+
+  return (val >> (bit & 7)) & ((U_LONG(1) << bitc) - U_LONG(1));
+}
+
+static void _cache_pk_set (
+  _InOut u_byte_t * set,
+  _In    u_word_t   pkz,
+  _In    u_word_t   bit,
+  _In    u_word_t   bitc,
+  _In    u_long_t   val
+)
+{
+  if (U_WORD(56) < bitc) {
+    _cache_pk_set(set, pkz, bit, U_WORD(32), val);
+    _cache_pk_set(set, pkz, bit + U_WORD(32), bitc - U_WORD(32), val >> 32);
+    return;
+  }
+
+  u_word_t byti = bit >> 3;
+  u_long_t msk  = ((U_LONG(1) << bitc) - U_LONG(1)) << (bit & 7);
+  u_word_t i;
+
+  val = (val << (bit & 7)) & msk;
+
+  if (byti + U_WORD(8) <= pkz) {
+    u_long_t wrd;
+
+    memcpy(&wrd, set + byti, sizeof(wrd));
+    wrd = _cache_le64((_cache_le64(wrd) & ~msk) | val);
+    memcpy(set + byti, &wrd, sizeof(wrd));
+  } else {
+    for (i = byti; i < pkz; ++i) {
+      u_word_t sh = (i - byti) << 3;
+
+      set[i] = (u_byte_t)((set[i] & ~(msk >> sh)) | (val >> sh));
+    }
+  }
+}
+
+/* tag of a way, decoded in place */
+
+static inline u_long_t _cache_hdr_tag (
+  _In    struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi
+)
+{
+  if (!cache_get_ph(cache)) {
+    return cache_way_get_tag(
+      cache, cache->hdr_buf + seti * cache->hdr_len + wayi * cache->hdrc
+    );
+  }
+
+  return _cache_pk_get(
+    cache->hdr_buf + seti * cache->pkz, cache->pkz,
+    wayi * cache->pkb + U_WORD(2) + cache->rpb, cache->tagz
+  );
+}
+
+/*
+ * The headers of a stored set in the usual layout: in place, or unpacked
+ * into `upk_buf` until `_cache_hdr_put` packs them back.
+ */
+
+static u_byte_t * _cache_hdr_get (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti
+)
+{
+  if (!cache_get_ph(cache))
+    return cache->hdr_buf + seti * cache->hdr_len;
+
+  const u_byte_t * set = cache->hdr_buf + seti * cache->pkz;
+  u_word_t         stc = U_WORD(2) + cache->rpb;
+  u_word_t         wayi;
+
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    u_byte_t * way_hdr = cache->upk_buf + wayi * cache->hdrc;
+    u_word_t   bit     = wayi * cache->pkb;
+
+    way_hdr[0] = (u_byte_t)_cache_pk_get(set, cache->pkz, bit, stc);
+    cache_way_set_tag(
+      cache, way_hdr, _cache_pk_get(set, cache->pkz, bit + stc, cache->tagz)
+    );
+  }
+
+  return cache->upk_buf;
+}
+
+static void _cache_hdr_put (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti
+)
+{
+  if (!cache_get_ph(cache))
+    return;
+
+  u_byte_t * set = cache->hdr_buf + seti * cache->pkz;
+  u_word_t   stc = U_WORD(2) + cache->rpb;
+  u_word_t   wayi;
+
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    u_byte_t * way_hdr = cache->upk_buf + wayi * cache->hdrc;
+    u_word_t   bit     = wayi * cache->pkb;
+
+    _cache_pk_set(set, cache->pkz, bit, stc, way_hdr[0]);
+    _cache_pk_set(
+      set, cache->pkz, bit + stc, cache->tagz,
+      cache_way_get_tag(cache, way_hdr)
+    );
+  }
+}
+
+/* line data of a stored set and way, none in tag-only mode */
+
+static inline u_byte_t * _cache_set_dat (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti
+)
+{
+  if (cache_get_to(cache))
+    return NULL;
+
+  return cache->dat_buf + seti * cache->dat_len;
+}
+
+static inline u_byte_t * _cache_way_dat (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi
+)
+{
+  if (cache_get_to(cache))
+    return NULL;
+
+  return cache->dat_buf + seti * cache->dat_len + wayi * cache->datc;
+}
+
+/*
+ * Valid bitmap: one bit per way of every stored set, mirroring the valid
+ * bits of the headers so that probes walk only the valid ways.
+ */
+
+static inline int _cache_vld_get (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi
+)
+{
+  const u_long_t * vld = cache->vld_buf + seti * cache->vldz;
+
+  return (int)(
+    (__atomic_load_n(vld + (wayi >> 6), __ATOMIC_RELAXED) >> (wayi & 63)) &
+    U_LONG(1)
+  );
+}
+
+static inline void _cache_vld_set (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi
+)
+{
+  cache->vld_buf[seti * cache->vldz + (wayi >> 6)] |= U_LONG(1) << (wayi & 63);
+}
+
+static inline void _cache_vld_clr (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi
+)
+{
+  cache->vld_buf[seti * cache->vldz + (wayi >> 6)] &= ~(
+    U_LONG(1) << (wayi & 63)
+  );
+}
+
+static void _cache_vld_sync (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti
+)
+{
+  u_long_t * vld     = cache->vld_buf + seti * cache->vldz;
+  u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+  u_word_t   wayi;
+
+  memset(vld, 0, cache->vldz * sizeof(u_long_t));
+
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    if (cache_way_get_valid(cache, set_hdr + wayi * cache->hdrc)) {
+      _cache_vld_set(cache, seti, wayi);
+    }
+  }
+}
+
+/* pin counts, one per way of every stored set */
+
+static inline u_word_t * _cache_pin_cnt (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi
+)
+{
+  return cache->pin_buf + (size_t)seti * cache->wayc + wayi;
+}
+
+static void _cache_pin_drop (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti
+)
+{
+  u_word_t wayi;
+
+  for (wayi = U_WORD(0); wayi < cache->wayc && cache->pinc; ++wayi) {
+    cache->pinc                      -= *_cache_pin_cnt(cache, seti, wayi);
+    *_cache_pin_cnt(cache, seti, wayi) = U_WORD(0);
+  }
+}
+
+/* owner of every stored line while partitioned, see `cache_part` */
+
+static inline u_byte_t * _cache_rq_own (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi
+)
+{
+  return cache->own_buf + (size_t)seti * cache->wayc + wayi;
+}
+
+static void _cache_rq_drop (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti
+)
+{
+  u_word_t wayi;
+
+  for (wayi = U_WORD(0); wayi < cache->wayc && cache->rqc; ++wayi) {
+    u_byte_t * own = _cache_rq_own(cache, seti, wayi);
+
+    if (CACHE_RQ_NONE == *own || _cache_vld_get(cache, seti, wayi))
+      continue;
+
+    --cache->rq_buf[*own].occc;
+    *own = CACHE_RQ_NONE;
+  }
+}
+
+static void _cache_rq_take (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi
+)
+{
+  if (!cache->rqc)
+    return;
+
+  u_byte_t * own = _cache_rq_own(cache, seti, wayi);
+
+  if (CACHE_RQ_NONE != *own) {
+    --cache->rq_buf[*own].occc;
+  }
+
+  *own = (u_byte_t)cache->rqi;
+  ++cache->rq_buf[cache->rqi].occc;
+}
+
+/*
+ * Statistics counters. In concurrent mode every thread adds its counts to
+ * one of `_CACHE_CNT_SLOTC` host cache lines of the cache, picked by a
+ * thread number, so that the counters do not bounce between cores on every
+ * access; `cache_stat` adds the slots in and `cache_cc_sync` folds them
+ * into the counter fields.
+ */
+
+# define _CACHE_CNT_RD_HIT 0
+# define _CACHE_CNT_RD_MIS 1
+# define _CACHE_CNT_WR_HIT 2
+# define _CACHE_CNT_WR_MIS 3
+# define _CACHE_CNT_SKP    4
+# define _CACHE_CNT_WP_HIT 5
+# define _CACHE_CNT_WP_MIS 6
+# define _CACHE_CNT_WP_PRB 7
+# define _CACHE_CNTC       8 /* one host cache line of counts */
+# define _CACHE_CNT_SLOTC  64
+
+/* auxiliary per-set state, rebuilt rather than checkpointed */
+
+static int _cache_aux_ctor (
+  _InOut struct cache_t * cache
+)
+{
+  u_word_t seti;
+
+  cache->vldz    = u_round_up(cache->wayc, U_WORD(64));
+  cache->vldm    = ~U_LONG(0) >> ((U_WORD(64) - cache->wayc % 64) % 64);
+  cache->vld_buf = (u_long_t *)calloc(
+    (size_t)cache->smpc * cache->vldz, sizeof(u_long_t)
+  );
+
+  if (!cache->vld_buf)
+    return CACHE_FAILURE;
+
+  cache->pin_buf = (u_word_t *)calloc(
+    (size_t)cache->smpc * cache->wayc, sizeof(u_word_t)
+  );
+  cache->pinc    = U_LONG(0);
+
+  if (!cache->pin_buf)
+    return CACHE_FAILURE;
+
+  if (cache_get_ph(cache)) {
+    cache->upk_buf = (u_byte_t *)malloc(cache->hdr_len);
+
+    if (!cache->upk_buf)
+      return CACHE_FAILURE;
+  }
+
+  /* a loaded checkpoint already holds lines */
+
+  for (seti = U_WORD(0); seti < cache->smpc && cache_get_mm(cache); ++seti) {
+    _cache_vld_sync(cache, seti);
+  }
+
+  if (cache_get_cc(cache)) {
+    size_t cnt_len = _CACHE_CNT_SLOTC * _CACHE_CNTC * sizeof(u_long_t);
+
+    cache->seq_buf = (u_word_t *)calloc(cache->smpc, sizeof(u_word_t));
+    cache->cnt_buf = (u_long_t *)aligned_alloc(64, cnt_len);
+
+    if (!cache->seq_buf || !cache->cnt_buf)
+      return CACHE_FAILURE;
+
+    memset(cache->cnt_buf, 0, cnt_len);
+  }
+
+  if (cache->smpz) {
+    cache->smp_buf = (u_long_t *)calloc(
+      (size_t)cache->smpc * U_WORD(2), sizeof(u_long_t)
+    );
+
+    if (!cache->smp_buf)
+      return CACHE_FAILURE;
+  }
+
+  if (cache_get_wp(cache)) {
+    cache->wpr_buf = (u_word_t *)calloc(cache->smpc, sizeof(u_word_t));
+
+    if (!cache->wpr_buf)
+      return CACHE_FAILURE;
+  }
+
+  if (cache_get_pt(cache)) {
+    u_byte_t msk[8] = { 0 };
+    u_word_t wayi;
+
+    cache->ptgz    = u_round_up(cache->wayc, U_WORD(8)) * U_WORD(8);
+    cache->ptg_buf = (u_byte_t *)calloc(cache->smpc, cache->ptgz);
+
+    if (!cache->ptg_buf)
+      return CACHE_FAILURE;
+
+    /* byte order independent mask of the ways in the last word */
+
+    for (wayi = cache->ptgz - U_WORD(8); wayi < cache->wayc; ++wayi) {
+      msk[wayi & 7] = U_BYTE(0x80);
+    }
+
+    memcpy(&cache->ptgm, msk, sizeof(msk));
+
+    for (seti = U_WORD(0); seti < cache->smpc && cache_get_mm(cache); ++seti) {
+      for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+        if (!_cache_vld_get(cache, seti, wayi))
+          continue;
+
+        _cache_pt_set(cache, seti, wayi, _cache_hdr_tag(cache, seti, wayi));
+      }
+    }
+  }
+
+  return CACHE_SUCCESS;
+}
+
+static void _cache_aux_dtor (
+  _InOut struct cache_t * cache
+)
+{
+  cache_cc_sync(cache);
+
+  free(cache->seq_buf);
+  cache->seq_buf = NULL;
+  free(cache->cnt_buf);
+  cache->cnt_buf = NULL;
+  free(cache->smp_buf);
+  cache->smp_buf = NULL;
+  free(cache->wpr_buf);
+  cache->wpr_buf = NULL;
+  free(cache->ptg_buf);
+  cache->ptg_buf = NULL;
+  free(cache->vld_buf);
+  cache->vld_buf = NULL;
+  free(cache->pin_buf);
+  cache->pin_buf = NULL;
+  free(cache->upk_buf);
+  cache->upk_buf = NULL;
+  free(cache->own_buf);
+  cache->own_buf = NULL;
+  free(cache->rq_buf);
+  cache->rq_buf  = NULL;
+  cache->rqc     = U_WORD(0);
+}
+
+static u_long_t * _cache_cnt_ptr (
+  _InOut struct cache_t * cache,
+  _In    int              cnti
+)
+{
+  switch (cnti) {
+  case _CACHE_CNT_RD_HIT: return &cache->rd_hitc;
+  case _CACHE_CNT_RD_MIS: return &cache->rd_misc;
+  case _CACHE_CNT_WR_HIT: return &cache->wr_hitc;
+  case _CACHE_CNT_WR_MIS: return &cache->wr_misc;
+  case _CACHE_CNT_WP_HIT: return &cache->wp_hitc;
+  case _CACHE_CNT_WP_MIS: return &cache->wp_misc;
+  case _CACHE_CNT_WP_PRB: return &cache->wp_prbc;
+  default:                return &cache->skpc;
+  }
+}
+
+static u_word_t _cache_cnt_tidc;
+
+static inline u_long_t * _cache_cnt_slot (
+  _In    const struct cache_t * cache
+)
+{
+  static _Thread_local u_word_t tid;
+
+  if (!tid) {
+    tid = __atomic_add_fetch(&_cache_cnt_tidc, U_WORD(1), __ATOMIC_RELAXED);
+  }
+
+  return cache->cnt_buf + (tid % _CACHE_CNT_SLOTC) * _CACHE_CNTC;
+}
+
+static void _cache_cnt_add (
+  _InOut struct cache_t * cache,
+  _In    int              cnti,
+  _In    u_word_t         val
+)
+{
+  if (!cache_get_cc(cache)) {
+    *_cache_cnt_ptr(cache, cnti) += val;
+    return;
+  }
+
+  /* threads sharing a slot only contend with each other */
+
+  __atomic_fetch_add(
+    _cache_cnt_slot(cache) + cnti, (u_long_t)val, __ATOMIC_RELAXED
+  );
+}
+
+/* a counter with the counts still in the slots */
+
+static u_long_t _cache_cnt_get (
+  _In    const struct cache_t * cache,
+  _In    int                    cnti
+)
+{
+  const u_long_t * fld;
+  u_word_t         sloti;
+
+  switch (cnti) {
+  case _CACHE_CNT_RD_HIT: fld = &cache->rd_hitc; break;
+  case _CACHE_CNT_RD_MIS: fld = &cache->rd_misc; break;
+  case _CACHE_CNT_WR_HIT: fld = &cache->wr_hitc; break;
+  case _CACHE_CNT_WR_MIS: fld = &cache->wr_misc; break;
+  case _CACHE_CNT_WP_HIT: fld = &cache->wp_hitc; break;
+  case _CACHE_CNT_WP_MIS: fld = &cache->wp_misc; break;
+  case _CACHE_CNT_WP_PRB: fld = &cache->wp_prbc; break;
+  default:                fld = &cache->skpc;    break;
+  }
+
+  /* `cache_cc_sync` may be adding to the field meanwhile */
+
+  u_long_t val = __atomic_load_n(fld, __ATOMIC_RELAXED);
+
+  for (sloti = U_WORD(0); cache->cnt_buf && sloti < _CACHE_CNT_SLOTC; ++sloti) {
+    val += __atomic_load_n(
+      cache->cnt_buf + sloti * _CACHE_CNTC + cnti, __ATOMIC_RELAXED
+    );
+  }
+
+  return val;
+}
+
+static inline void _cache_cnt (
+  _InOut struct cache_t * cache,
+  _In    int              cnti
+)
+{
+  _cache_cnt_add(cache, cnti, U_WORD(1));
+}
+
+/* an access to stored set `seti`, kept per set for the sampling interval */
+
+static inline void _cache_smp_cnt (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         misc
+)
+{
+  if (!cache->smp_buf)
+    return;
+
+  u_long_t * cnt = cache->smp_buf + U_WORD(2) * seti;
+
+  if (!cache_get_cc(cache)) {
+    cnt[0] += U_LONG(1);
+    cnt[1] += misc;
+    return;
+  }
+
+  __atomic_fetch_add(cnt, U_LONG(1), __ATOMIC_RELAXED);
+
+  if (misc) {
+    __atomic_fetch_add(cnt + 1, U_LONG(1), __ATOMIC_RELAXED);
+  }
+}
+
+void cache_cc_sync (
+  _InOut struct cache_t * cache
+)
+{
+  u_word_t sloti;
+  int      cnti;
+
+  for (sloti = U_WORD(0); cache->cnt_buf && sloti < _CACHE_CNT_SLOTC; ++sloti) {
+    for (cnti = 0; cnti < _CACHE_CNTC; ++cnti) {
+      u_long_t val = __atomic_exchange_n(
+        cache->cnt_buf + sloti * _CACHE_CNTC + cnti, U_LONG(0),
+        __ATOMIC_RELAXED
+      );
+
+      if (val) {
+        __atomic_fetch_add(_cache_cnt_ptr(cache, cnti), val, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+/*
+ * Per-set sequence locks: the count is odd while a writer owns the set.
+ * Readers sample it before and after their probe and retry on a change.
+ */
+
+static void _cache_seq_lock (
+  _InOut u_word_t * seq
+)
+{
+  for (;;) {
+    u_word_t val = __atomic_load_n(seq, __ATOMIC_RELAXED);
+
+    if (
+      !(val & 1) &&
+      __atomic_compare_exchange_n(
+        seq, &val, val + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+      )
+    )
+      break;
+  }
+
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static int _cache_seq_trylock (
+  _InOut u_word_t * seq,
+  _In    u_word_t   val
+)
+{
+  if (
+    !__atomic_compare_exchange_n(
+      seq, &val, val + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED
+    )
+  )
+    return 0;
+
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return 1;
+}
+
+static void _cache_seq_unlock (
+  _InOut u_word_t * seq
+)
+{
+  __atomic_store_n(
+    seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE
+  );
+}
+
+static u_word_t _cache_seq_begin (
+  _In    const u_word_t * seq
+)
+{
+  u_word_t val;
+
+  while ((val = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1);
+
+  return val;
+}
+
+/* a copy that may race with a writer, kept only if the set did not change */
+
+static void _cache_seq_copy (
+  _Out   u_byte_t *       dst,
+  _In    const u_byte_t * src,
+  _In    u_word_t         len
+)
+{
+  for (; len && ((uintptr_t)src & 7); --len) {
+    *dst++ = __atomic_load_n(src++, __ATOMIC_RELAXED);
+  }
+
+  for (; len >= U_WORD(8); len -= U_WORD(8)) {
+    u_long_t val = __atomic_load_n((const u_long_t *)src, __ATOMIC_RELAXED);
+
+    memcpy(dst, &val, sizeof(val));
+    dst += 8;
+    src += 8;
+  }
+
+  for (; len; --len) {
+    *dst++ = __atomic_load_n(src++, __ATOMIC_RELAXED);
+  }
+}
+
+static int _cache_seq_retry (
+  _In    const u_word_t * seq,
+  _In    u_word_t         val
+)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return val != __atomic_load_n(seq, __ATOMIC_RELAXED);
+}
+
+void cache_way_set_tag (
+  _InOut struct cache_t * cache,
+  _InOut u_byte_t *       way_hdr,
+  _In    u_long_t         tag
+)
+{
+  u_byte_t * hdr = (u_byte_t *)way_hdr + 1;
+
+  u_word_t tags = cache->tagz / U_WORD(8);
+  u_word_t tagr = cache->tagz % U_WORD(8);
+  u_word_t tagi;
+
+  if (tagr) {
+    u_byte_t tagm = (U_BYTE(1) << tagr) - U_BYTE(1);
+
+    hdr[tags] = (u_byte_t)(
+      tag >> (cache->tagz - tagr)
+    ) & tagm;
+  }
+
+  for (tagi = U_WORD(0); tagi < tags; ++tagi) {
+    hdr[tagi] = (u_byte_t)tag;
+    tag >>= 8;
+  }
+}
+
+u_long_t cache_way_get_tag (
+  _InOut struct cache_t * cache,
+  _In    const u_byte_t * way_hdr
+)
+{
+  u_byte_t * hdr = (u_byte_t *)way_hdr + 1;
+
+  u_long_t tag  = U_LONG(0);
+  u_word_t tags = cache->tagz / U_WORD(8);
+  u_word_t tagr = cache->tagz % U_WORD(8);
+  u_word_t tagi;
+
+  for (tagi = tags; tagi > 0; tagi) {
+    tag <<= 8;
+    tag  |= __atomic_load_n(hdr + --tagi, __ATOMIC_RELAXED);
+  }
+
+  if (!tagr)
+    return tag;
+
+  u_byte_t tagm = (U_BYTE(1) << tagr) - U_BYTE(1);
+
+  tag |= (
+    (u_long_t)(__atomic_load_n(hdr + tags, __ATOMIC_RELAXED) & tagm) <<
+    (cache->tagz - tagr)
+  );
+
+  return tag;
+}
+
+int cache_reset (
+  _InOut struct cache_t * cache,
+  _InOut u_word_t *       _seti
+)
+{
+  u_word_t seti = _seti ? *_seti : U_WORD(0);
+
+  for (seti; seti < cache->smpc; ++seti) {
+    u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+    u_byte_t * set_dat = _cache_set_dat(cache, seti);
+
+    u_word_t * seq = cache->seq_buf ? cache->seq_buf + seti : NULL;
+
+    if (seq) {
+      _cache_seq_lock(seq);
+    }
+
+    int res = cache->rp_reset(cache, set_hdr, set_dat);
+
+    _cache_hdr_put(cache, seti);
+    _cache_vld_sync(cache, seti);
+    _cache_pin_drop(cache, seti);
+    _cache_rq_drop(cache, seti);
+
+    if (seq) {
+      _cache_seq_unlock(seq);
+    }
+
+    if (res < 0)
+      return CACHE_FAILURE;
+
+    if (!res)
+      continue;
+
+    if (_seti) {
+      *_seti = seti;
+    }
+
+    cache_set_wr(cache);
+    return CACHE_WAITING;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+static void _cache_sec_fill (
+  _InOut u_byte_t * msk,
+  _In    u_word_t   lo,
+  _In    u_word_t   hi
+)
+{
+  for (; lo < hi; ++lo) {
+    msk[lo >> 3] |= U_BYTE(1) << (lo & 7);
+  }
+}
+
+static int _cache_sec_test (
+  _In    const u_byte_t * msk,
+  _In    u_word_t         lo,
+  _In    u_word_t         hi
+)
+{
+  for (; lo < hi; ++lo) {
+    u_byte_t val = __atomic_load_n(msk + (lo >> 3), __ATOMIC_RELAXED);
+
+    if (!(val & (U_BYTE(1) << (lo & 7))))
+      return 0;
+  }
+
+  return 1;
+}
+
+static void _cache_way_sec_write (
+  _InOut struct cache_t * cache,
+  _InOut u_byte_t *       way_hdr,
+  _In    u_word_t         dati,
+  _In    u_word_t         len,
+  _In    int              fill
+)
+{
+  if (cache->secc < U_WORD(2))
+    return;
+
+  u_byte_t * val = cache_way_sec_valid(cache, way_hdr);
+  u_byte_t * dty = cache_way_sec_dirty(cache, way_hdr);
+  u_word_t   secm = (U_WORD(1) << cache->secs) - U_WORD(1);
+
+  if (fill) {
+    memset(val, 0, U_WORD(2) * cache->secb + cache->datb);
+  }
+
+  /* partially written sectors are dirty but not valid */
+
+  _cache_sec_fill(cache_way_dat_dirty(cache, way_hdr), dati, dati + len);
+  _cache_sec_fill(
+    dty, dati >> cache->secs, ((dati + len - 1) >> cache->secs) + 1
+  );
+  _cache_sec_fill(
+    val, (dati + secm) >> cache->secs, (dati + len) >> cache->secs
+  );
+}
+
+static int _cache_way_sec_read (
+  _In    struct cache_t * cache,
+  _In    const u_byte_t * way_hdr,
+  _In    u_word_t         dati,
+  _In    u_word_t         len
+)
+{
+  if (cache->secc < U_WORD(2))
+    return 1;
+
+  return _cache_sec_test(
+    cache_way_sec_valid(cache, way_hdr),
+    dati >> cache->secs, ((dati + len - 1) >> cache->secs) + 1
+  );
+}
+
+static u_word_t _cache_fold (
+  _In    const struct cache_t * cache,
+  _In    u_long_t               val
+)
+{
+  u_word_t idx = U_WORD(0);
+
+  if (!cache->idxz)
+    return idx;
+
+  for (; val; val >>= cache->idxz) {
+    idx ^= (u_word_t)val;
+  }
+
+  return idx & cache->setm;
+}
+
+/* logical set index of `adr` in way `wayi`, with its tag */
+
+static u_word_t _cache_index (
+  _In    const struct cache_t * cache,
+  _In    u_long_t               adr,
+  _In    u_word_t               wayi,
+  _Out   u_long_t *             tag
+)
+{
+  u_long_t blk = adr >> cache->sets;
+
+  switch (cache->idxf) {
+  case CACHE_INDEX_XOR:
+    *tag = (adr >> cache->tags) & cache->tagm;
+    return ((u_word_t)blk ^ _cache_fold(cache, *tag)) & cache->setm;
+
+  case CACHE_INDEX_PRIME:
+    *tag = (blk / cache->setc) & cache->tagm;
+    return (u_word_t)(blk % cache->setc);
+
+  case CACHE_INDEX_SKEW: {
+    u_long_t bnki = wayi / (cache->wayc / cache->bnkc);
+    u_long_t mix;
+
+    *tag = (adr >> cache->tags) & cache->tagm;
+    mix  = (*tag + bnki) * U_LONG(0x9E3779B97F4A7C15);
+
+    return ((u_word_t)blk ^ _cache_fold(cache, mix ^ (mix >> 29))) & (
+      cache->setm
+    );
+  }
+
+  default:
+    *tag = (adr >> cache->tags) & cache->tagm;
+    return (u_word_t)blk & cache->setm;
+  }
+}
+
+u_long_t cache_adr (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi,
+  _In    u_long_t               tag
+)
+{
+  u_long_t blk = seti;
+
+  switch (cache->idxf) {
+  case CACHE_INDEX_XOR:
+    blk ^= _cache_fold(cache, tag);
+    break;
+
+  case CACHE_INDEX_PRIME:
+    return (tag * cache->setc + seti) << cache->sets;
+
+  case CACHE_INDEX_SKEW: {
+    u_long_t bnki = wayi / (cache->wayc / cache->bnkc);
+    u_long_t mix  = (tag + bnki) * U_LONG(0x9E3779B97F4A7C15);
+
+    blk ^= _cache_fold(cache, mix ^ (mix >> 29));
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  return (tag << cache->tags) | ((blk & cache->setm) << cache->sets);
+}
+
+u_long_t cache_way_get_adr (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi,
+  _In    const u_byte_t * way_hdr
+)
+{
+  return cache_adr(cache, seti, wayi, cache_way_get_tag(cache, way_hdr));
+}
+
+/*
+ * Skewed-associative victim: each way lives in its own set, so prefer an
+ * invalid candidate, then a way the policy ranks as victim in its own set,
+ * then a way picked by the line tag.
+ */
+
+static u_word_t _cache_skew_victim (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_long_t         tag
+)
+{
+  u_word_t wayi, seti, vici;
+  u_long_t way_tag;
+
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    seti = _cache_index(cache, adr, wayi, &way_tag);
+
+    if (!_cache_vld_get(cache, seti, wayi))
+      return wayi;
+  }
+
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    seti = _cache_index(cache, adr, wayi, &way_tag);
+
+    u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+    u_byte_t * set_dat = _cache_set_dat(cache, seti);
+
+    if (!cache->rp_get(cache, set_hdr, set_dat, &vici) && vici == wayi)
+      return wayi;
+  }
+
+  return (u_word_t)(tag % cache->wayc);
+}
+
+static inline void _cache_evt (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         type,
+  _In    u_long_t         adr,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi,
+  _In    u_long_t         tag
+)
+{
+  if (cache->evt) {
+    cache_evt_put(
+      cache->evt, type, adr, cache_set_logical(cache, seti), wayi, tag
+    );
+  }
+
+  if (cache->c3 && type < CACHE_EVT_FILL) {
+    cache_c3_put(cache->c3, type, adr, seti);
+  }
+
+  if (cache->rqc && type < CACHE_EVT_FILL) {
+    struct cache_rq_t * rq = cache->rq_buf + cache->rqi;
+
+    ++rq->accc;
+    rq->misc += CACHE_EVT_RD_MISS == type || CACHE_EVT_WR_MISS == type;
+  }
+}
+
+/*
+ * Way prediction: the predicted way of a set is probed before the others.
+ */
+
+static inline u_word_t _cache_wp_get (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti
+)
+{
+  if (!cache->wpr_buf)
+    return U_WORD(0);
+
+  return __atomic_load_n(cache->wpr_buf + seti, __ATOMIC_RELAXED);
+}
+
+static inline void _cache_wp_set (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi
+)
+{
+  if (cache->wpr_buf) {
+    __atomic_store_n(cache->wpr_buf + seti, wayi, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * Fused set probe, shared by reads, writes and fills. One walk over the
+ * valid ways of the set, taken from the valid bitmap with one ctz per way
+ * and the predicted way first, finds the hit way; the first free way comes
+ * from the same bitmap. With skewed indexing every way lives in its own
+ * set, so each way is checked in the set of its own index function.
+ */
+
+struct _cache_prb_t {
+  u_long_t tag;  /* tag of the hit way                     */
+  u_word_t seti; /* set of the hit way, else the home set  */
+  u_word_t wayi; /* hit way, else `wayc`                   */
+  u_word_t free; /* first invalid way, else `wayc`         */
+  u_word_t prbc; /* full tag compares                      */
+  int      prdh; /* the hit was on the predicted way       */
+};
+
+static void _cache_probe (
+  _InOut struct cache_t *      cache,
+  _In    u_long_t              adr,
+  _In    u_long_t              tag,
+  _In    u_word_t              seti,
+  _Out   struct _cache_prb_t * prb
+)
+{
+  u_word_t wayi, wrdi;
+
+  prb->tag  = tag;
+  prb->seti = seti;
+  prb->wayi = cache->wayc;
+  prb->free = cache->wayc;
+  prb->prbc = U_WORD(0);
+  prb->prdh = 0;
+
+  if (CACHE_INDEX_SKEW == cache->idxf) {
+    for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+      u_long_t way_tag;
+      u_word_t way_seti = _cache_index(cache, adr, wayi, &way_tag);
+
+      if (!_cache_vld_get(cache, way_seti, wayi)) {
+        if (prb->free == cache->wayc) {
+          prb->free = wayi;
+        }
+
+        continue;
+      }
+
+      ++prb->prbc;
+
+      if (_cache_hdr_tag(cache, way_seti, wayi) == way_tag) {
+        prb->tag  = way_tag;
+        prb->seti = way_seti;
+        prb->wayi = wayi;
+        return;
+      }
+    }
+
+    return;
+  }
+
+  const u_long_t * vld  = cache->vld_buf + seti * cache->vldz;
+  u_byte_t *       ptg  = _cache_pt_row(cache, seti);
+  u_byte_t         pt   = _cache_pt_hash(tag);
+  u_word_t         prdi = _cache_wp_get(cache, seti);
+
+  for (wrdi = U_WORD(0); wrdi < cache->vldz; ++wrdi) {
+    u_long_t inv = ~__atomic_load_n(vld + wrdi, __ATOMIC_RELAXED);
+
+    if (wrdi + U_WORD(1) == cache->vldz) {
+      inv &= cache->vldm;
+    }
+
+    /* a partitioned cache has a single word */
+
+    if (cache->rqc) {
+      inv &= cache->wmsk;
+    }
+
+    if (inv) {
+      prb->free = (wrdi << 6) + (u_word_t)__builtin_ctzll(inv);
+      break;
+    }
+  }
+
+  if (!_cache_pt_any(cache, ptg, pt))
+    return;
+
+  if (
+    cache->wpr_buf                        &&
+    _cache_vld_get(cache, seti, prdi)     &&
+    (!ptg || __atomic_load_n(ptg + prdi, __ATOMIC_RELAXED) == pt)
+  ) {
+    ++prb->prbc;
+
+    if (_cache_hdr_tag(cache, seti, prdi) == tag) {
+      prb->wayi = prdi;
+      prb->prdh = 1;
+      return;
+    }
+  }
+
+  for (wrdi = U_WORD(0); wrdi < cache->vldz; ++wrdi) {
+    u_long_t msk = __atomic_load_n(vld + wrdi, __ATOMIC_RELAXED);
+
+    if (cache->wpr_buf && (prdi >> 6) == wrdi) {
+      msk &= ~(U_LONG(1) << (prdi & 63));
+    }
+
+    for (; msk; msk &= msk - U_LONG(1)) {
+      wayi = (wrdi << 6) + (u_word_t)__builtin_ctzll(msk);
+
+      if (ptg && __atomic_load_n(ptg + wayi, __ATOMIC_RELAXED) != pt)
+        continue;
+
+      ++prb->prbc;
+
+      if (_cache_hdr_tag(cache, seti, wayi) == tag) {
+        prb->wayi = wayi;
+        return;
+      }
+    }
+  }
+}
+
+static inline void _cache_wp_hit (
+  _InOut struct cache_t *             cache,
+  _In    const struct _cache_prb_t * prb
+)
+{
+  if (!cache->wpr_buf)
+    return;
+
+  _cache_cnt(cache, prb->prdh ? _CACHE_CNT_WP_HIT : _CACHE_CNT_WP_MIS);
+  _cache_cnt_add(cache, _CACHE_CNT_WP_PRB, prb->prbc);
+
+  if (!prb->prdh) {
+    _cache_wp_set(cache, prb->seti, prb->wayi);
+  }
+}
+
+/*
+ * Prepare the way that receives `adr` on a miss: the free way found by the
+ * probe, else the policy victim, else, when that one is pinned or outside
+ * the requestor's mask, the next way that is neither. With an `evict`
+ * callback a dirty victim is written back first, and the miss waits or
+ * fails with it; without one the victim is dropped.
+ */
+
+static int _cache_alloc (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _InOut u_long_t *       tag,
+  _InOut u_word_t *       _seti,
+  _In    u_word_t         free,
+  _Out   u_word_t *       _wayi
+)
+{
+  u_word_t seti = *_seti;
+  u_word_t wayi = free;
+
+  if (CACHE_INDEX_SKEW == cache->idxf) {
+    if (wayi == cache->wayc) {
+      wayi = _cache_skew_victim(cache, adr, *tag);
+    }
+
+    seti = _cache_index(cache, adr, wayi, tag);
+  }
+
+  u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+  u_byte_t * set_dat = _cache_set_dat(cache, seti);
+
+  if (wayi == cache->wayc) {
+    int res = cache->rp_get(cache, set_hdr, set_dat, &wayi);
+
+    if (res)
+      return CACHE_FAILURE;
+  }
+
+  if (
+    (cache->pinc && *_cache_pin_cnt(cache, seti, wayi)) ||
+    !cache_way_permitted(cache, wayi)
+  ) {
+    u_word_t prbi;
+
+    for (prbi = U_WORD(1); prbi < cache->wayc; ++prbi) {
+      u_word_t way_seti = seti;
+      u_word_t way_wayi = (wayi + prbi) % cache->wayc;
+
+      if (CACHE_INDEX_SKEW == cache->idxf) {
+        way_seti = _cache_index(cache, adr, way_wayi, tag);
+      }
+
+      if (
+        !*_cache_pin_cnt(cache, way_seti, way_wayi) &&
+        cache_way_permitted(cache, way_wayi)
+      ) {
+        seti = way_seti;
+        wayi = way_wayi;
+        break;
+      }
+    }
+
+    if (prbi == cache->wayc)
+      return CACHE_WAITING;
+
+    set_hdr = _cache_hdr_get(cache, seti);
+    set_dat = _cache_set_dat(cache, seti);
+  }
+
+  u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+  u_byte_t * way_dat = _cache_way_dat(cache, seti, wayi);
+  u_word_t   set_log = cache_set_logical(cache, seti);
+
+  if (
+    cache_way_get_valid(cache, way_hdr) &&
+    cache_way_get_dirty(cache, way_hdr) &&
+    cache->evict
+  ) {
+    int res = cache->evict(cache, set_log, way_hdr, way_dat);
+
+    if (res)
+      return res < 0 ? CACHE_FAILURE : CACHE_WAITING;
+
+    if (cache->evt) {
+      _cache_evt(
+        cache, CACHE_EVT_WRITEBACK,
+        cache_way_get_adr(cache, set_log, wayi, way_hdr),
+        seti, wayi, cache_way_get_tag(cache, way_hdr)
+      );
+    }
+  }
+
+  /* the victim is logged under its own address, not the incoming one */
+
+  if (cache->evt && cache_way_get_valid(cache, way_hdr)) {
+    _cache_evt(
+      cache, CACHE_EVT_EVICT,
+      cache_way_get_adr(cache, set_log, wayi, way_hdr),
+      seti, wayi, cache_way_get_tag(cache, way_hdr)
+    );
+  }
+
+  cache_way_clr_valid(cache, way_hdr);
+  cache_way_clr_dirty(cache, way_hdr);
+  _cache_hdr_put(cache, seti);
+  _cache_vld_clr(cache, seti, wayi);
+  _cache_wp_set(cache, seti, wayi);
+  _cache_pt_set(cache, seti, wayi, *tag);
+  _cache_rq_take(cache, seti, wayi);
+
+  *_seti = seti;
+  *_wayi = wayi;
+
+  return CACHE_SUCCESS;
+}
+
+static int _cache_write (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_word_t         len,
+  _In    const u_byte_t * dat
+)
+{
+  if (cache_get_wr(cache) || cache_get_wf(cache))
+    return CACHE_WAITING;
+
+  u_long_t tag;
+  u_word_t seti = _cache_index(cache, adr, U_WORD(0), &tag);
+  u_word_t wayi;
+  u_word_t dati = (u_word_t)(adr >> cache->dats) & cache->datm;
+
+  if (!cache_set_sampled(cache, seti)) {
+    _cache_cnt(cache, _CACHE_CNT_SKP);
+    return CACHE_SKIPPED;
+  }
+
+  seti = cache_set_stored(cache, seti);
+
+  if (!len || cache->datc < dati + len) {
+    len = cache->datc - dati;
+  }
+
+  struct _cache_prb_t prb;
+
+  _cache_probe(cache, adr, tag, seti, &prb);
+
+  if (prb.wayi < cache->wayc) {
+    seti = prb.seti;
+    wayi = prb.wayi;
+
+    u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+    u_byte_t * set_dat = _cache_set_dat(cache, seti);
+    u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+    u_byte_t * way_dat = _cache_way_dat(cache, seti, wayi);
+
+    if (way_dat && dat) {
+      memcpy(way_dat + dati, dat, len);
+    }
+
+    cache_way_set_dirty(cache, way_hdr);
+    _cache_way_sec_write(cache, way_hdr, dati, len, 0);
+    cache->rp_set(cache, set_hdr, set_dat, wayi);
+    _cache_hdr_put(cache, seti);
+    _cache_cnt(cache, _CACHE_CNT_WR_HIT);
+    _cache_smp_cnt(cache, seti, U_WORD(0));
+    _cache_wp_hit(cache, &prb);
+    _cache_evt(cache, CACHE_EVT_WR_HIT, adr, seti, wayi, prb.tag);
+
+    return CACHE_SUCCESS;
+  }
+
+  /* without sectors a partial line would be valid around stale bytes */
+
+  if (
+    cache->secc < U_WORD(2) && len < cache->datc &&
+    dat && !cache_get_to(cache)
+  ) {
+    _cache_cnt(cache, _CACHE_CNT_WR_MIS);
+    _cache_smp_cnt(cache, seti, U_WORD(1));
+    _cache_evt(cache, CACHE_EVT_WR_MISS, adr, seti, cache->wayc, tag);
+    return CACHE_FAILURE;
+  }
+
+  u_word_t smpi = seti;
+  int      res  = _cache_alloc(cache, adr, &tag, &seti, prb.free, &wayi);
+
+  if (CACHE_WAITING != res) {
+    _cache_cnt(cache, _CACHE_CNT_WR_MIS);
+    _cache_smp_cnt(cache, smpi, U_WORD(1));
+  }
+
+  if (res)
+    return res;
+
+  u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+  u_byte_t * set_dat = _cache_set_dat(cache, seti);
+  u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+  u_byte_t * way_dat = _cache_way_dat(cache, seti, wayi);
+
+  if (way_dat && dat) {
+    memcpy(way_dat + dati, dat, len);
+  }
+
+  cache_way_set_valid(cache, way_hdr);
+  cache_way_set_dirty(cache, way_hdr);
+  cache_way_set_tag(cache, way_hdr, tag);
+  _cache_vld_set(cache, seti, wayi);
+  _cache_way_sec_write(cache, way_hdr, dati, len, 1);
+  cache->rp_set(cache, set_hdr, set_dat, wayi);
+  _cache_hdr_put(cache, seti);
+  _cache_evt(cache, CACHE_EVT_WR_MISS, adr, seti, wayi, tag);
+
+  return CACHE_SUCCESS;
+}
+
+static int _cache_fill (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    const u_byte_t * dat
+)
+{
+  if (cache_get_wr(cache) || cache_get_wf(cache))
+    return CACHE_WAITING;
+
+  u_long_t tag;
+  u_word_t seti = _cache_index(cache, adr, U_WORD(0), &tag);
+  u_word_t wayi;
+
+  if (!cache_set_sampled(cache, seti)) {
+    _cache_cnt(cache, _CACHE_CNT_SKP);
+    return CACHE_SKIPPED;
+  }
+
+  seti = cache_set_stored(cache, seti);
+
+  struct _cache_prb_t prb;
+
+  _cache_probe(cache, adr, tag, seti, &prb);
+
+  if (prb.wayi < cache->wayc) {
+    if (cache->secc < U_WORD(2))
+      return CACHE_SUCCESS;
+
+    u_byte_t * way_hdr = (
+      cache->hdr_buf + prb.seti * cache->hdr_len + prb.wayi * cache->hdrc
+    );
+    u_byte_t * way_dat = _cache_way_dat(cache, prb.seti, prb.wayi);
+
+    /* merge: sectors not valid take the fill data around written bytes */
+
+    u_byte_t * val = cache_way_sec_valid(cache, way_hdr);
+    u_word_t   secz = U_WORD(1) << cache->secs;
+    u_word_t   seci, dati;
+
+    for (seci = U_WORD(0); seci < cache->secc; ++seci) {
+      u_byte_t secm = U_BYTE(1) << (seci & 7);
+      u_word_t lo   = seci * secz;
+
+      if (val[seci >> 3] & secm)
+        continue;
+
+      for (dati = lo; way_dat && dat && dati < lo + secz; ++dati) {
+        if (!cache_way_get_dat_dirty(cache, way_hdr, dati)) {
+          way_dat[dati] = dat[dati];
+        }
+      }
+
+      val[seci >> 3] |= secm;
+    }
+
+    return CACHE_SUCCESS;
+  }
+
+  int res = _cache_alloc(cache, adr, &tag, &seti, prb.free, &wayi);
+
+  if (res)
+    return res;
+
+  u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+  u_byte_t * set_dat = _cache_set_dat(cache, seti);
+  u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+  u_byte_t * way_dat = _cache_way_dat(cache, seti, wayi);
+
+  if (way_dat && dat) {
+    memcpy(way_dat, dat, cache->datc);
+  }
+
+  cache_way_set_valid(cache, way_hdr);
+  cache_way_set_tag(cache, way_hdr, tag);
+  _cache_vld_set(cache, seti, wayi);
+
+  if (cache->secc > U_WORD(1)) {
+    memset(
+      cache_way_sec_valid(cache, way_hdr), 0,
+      U_WORD(2) * cache->secb + cache->datb
+    );
+    _cache_sec_fill(
+      cache_way_sec_valid(cache, way_hdr), U_WORD(0), cache->secc
+    );
+  }
+
+  cache->rp_set(cache, set_hdr, set_dat, wayi);
+  _cache_hdr_put(cache, seti);
+  _cache_evt(cache, CACHE_EVT_FILL, adr, seti, wayi, tag);
+
+  return CACHE_SUCCESS;
+}
+
+/*
+ * The read hit path, shared by `cache_read` and `cache_pin`. Without `cnt`
+ * the lookup is the retry of an access already counted.
+ */
+
+static int _cache_lookup (
+  _InOut struct cache_t *      cache,
+  _In    u_long_t              adr,
+  _InOut u_word_t *            _len,
+  _Out   u_word_t *            _dati,
+  _Out   struct _cache_prb_t * prb,
+  _In    int                   cnt
+)
+{
+  if (cache_get_wr(cache) || cache_get_wf(cache))
+    return CACHE_WAITING;
+
+  u_long_t tag;
+  u_word_t seti = _cache_index(cache, adr, U_WORD(0), &tag);
+  u_word_t dati = (u_word_t)(adr >> cache->dats) & cache->datm;
+  u_word_t len  = *_len;
+
+  if (!cache_set_sampled(cache, seti)) {
+    _cache_cnt(cache, _CACHE_CNT_SKP);
+    return CACHE_SKIPPED;
+  }
+
+  seti = cache_set_stored(cache, seti);
+
+  if (!len || cache->datc < dati + len) {
+    len = cache->datc - dati;
+  }
+
+  _cache_probe(cache, adr, tag, seti, prb);
+
+  if (prb->wayi < cache->wayc) {
+    u_byte_t * set_hdr = _cache_hdr_get(cache, prb->seti);
+    u_byte_t * set_dat = _cache_set_dat(cache, prb->seti);
+    u_byte_t * way_hdr = set_hdr + prb->wayi * cache->hdrc;
+
+    if (_cache_way_sec_read(cache, way_hdr, dati, len)) {
+      cache->rp_set(cache, set_hdr, set_dat, prb->wayi);
+      _cache_hdr_put(cache, prb->seti);
+
+      *_len  = len;
+      *_dati = dati;
+
+      if (!cnt)
+        return CACHE_SUCCESS;
+
+      _cache_cnt(cache, _CACHE_CNT_RD_HIT);
+      _cache_smp_cnt(cache, seti, U_WORD(0));
+      _cache_wp_hit(cache, prb);
+      _cache_evt(
+        cache, CACHE_EVT_RD_HIT, adr, prb->seti, prb->wayi, prb->tag
+      );
+
+      return CACHE_SUCCESS;
+    }
+  }
+
+  if (!cnt)
+    return CACHE_FAILURE;
+
+  _cache_cnt(cache, _CACHE_CNT_RD_MIS);
+  _cache_smp_cnt(cache, seti, U_WORD(1));
+  _cache_evt(cache, CACHE_EVT_RD_MISS, adr, prb->seti, cache->wayc, tag);
+
+  return CACHE_FAILURE;
+}
+
+static int _cache_read (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_word_t         len,
+  _Out   u_byte_t *       dat
+)
+{
+  struct _cache_prb_t prb;
+  u_word_t            dati;
+
+  int res = _cache_lookup(cache, adr, &len, &dati, &prb, 1);
+
+  if (res)
+    return res;
+
+  u_byte_t * way_dat = _cache_way_dat(cache, prb.seti, prb.wayi);
+
+  if (way_dat && dat) {
+    memcpy(dat, way_dat + dati, len);
+  }
+
+  return CACHE_SUCCESS;
+}
+
+/* lock the set of `adr` in concurrent mode, NULL if it is not stored */
+
+static u_word_t * _cache_seq_lock_adr (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr
+)
+{
+  u_long_t tag;
+  u_word_t seti = _cache_index(cache, adr, U_WORD(0), &tag);
+
+  if (!cache_set_sampled(cache, seti))
+    return NULL;
+
+  u_word_t * seq = cache->seq_buf + cache_set_stored(cache, seti);
+
+  _cache_seq_lock(seq);
+  return seq;
+}
+
+int cache_write (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_word_t         len,
+  _In    const u_byte_t * dat
+)
+{
+  if (!cache_get_cc(cache))
+    return _cache_write(cache, adr, len, dat);
+
+  u_word_t * seq = _cache_seq_lock_adr(cache, adr);
+  int        res = _cache_write(cache, adr, len, dat);
+
+  if (seq) {
+    _cache_seq_unlock(seq);
+  }
+
+  return res;
+}
+
+int cache_fill (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    const u_byte_t * dat
+)
+{
+  if (!cache_get_cc(cache))
+    return _cache_fill(cache, adr, dat);
+
+  u_word_t * seq = _cache_seq_lock_adr(cache, adr);
+  int        res = _cache_fill(cache, adr, dat);
+
+  if (seq) {
+    _cache_seq_unlock(seq);
+  }
+
+  return res;
+}
+
+/*
+ * Lock-free read: probe and copy under the set sequence count, then update
+ * the policy for a sample of the hits if no writer took the set meanwhile.
+ */
+
+static int _cache_read_cc (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_word_t         len,
+  _Out   u_byte_t *       dat
+)
+{
+  static _Thread_local u_word_t rp_cnt;
+
+  if (cache_get_wr(cache) || cache_get_wf(cache))
+    return CACHE_WAITING;
+
+  u_long_t tag;
+  u_word_t seti = _cache_index(cache, adr, U_WORD(0), &tag);
+  u_word_t dati = (u_word_t)(adr >> cache->dats) & cache->datm;
+
+  if (!cache_set_sampled(cache, seti)) {
+    _cache_cnt(cache, _CACHE_CNT_SKP);
+    return CACHE_SKIPPED;
+  }
+
+  seti = cache_set_stored(cache, seti);
+
+  if (!len || cache->datc < dati + len) {
+    len = cache->datc - dati;
+  }
+
+  u_byte_t * set_hdr = cache->hdr_buf + seti * cache->hdr_len;
+  u_byte_t * set_dat = _cache_set_dat(cache, seti);
+  u_word_t * seq     = cache->seq_buf + seti;
+  u_word_t   val;
+  int        hit;
+
+  struct _cache_prb_t prb;
+
+  do {
+    val = _cache_seq_begin(seq);
+    hit = 0;
+
+    _cache_probe(cache, adr, tag, seti, &prb);
+
+    if (prb.wayi < cache->wayc) {
+      u_byte_t * way_hdr = set_hdr + prb.wayi * cache->hdrc;
+      u_byte_t * way_dat = _cache_way_dat(cache, seti, prb.wayi);
+
+      if (_cache_way_sec_read(cache, way_hdr, dati, len)) {
+        if (way_dat && dat) {
+          _cache_seq_copy(dat, way_dat + dati, len);
+        }
+
+        hit = 1;
+      }
+    }
+  } while (_cache_seq_retry(seq, val));
+
+  if (!hit) {
+    _cache_cnt(cache, _CACHE_CNT_RD_MIS);
+    _cache_smp_cnt(cache, seti, U_WORD(1));
+    return CACHE_FAILURE;
+  }
+
+  _cache_cnt(cache, _CACHE_CNT_RD_HIT);
+  _cache_smp_cnt(cache, seti, U_WORD(0));
+  _cache_wp_hit(cache, &prb);
+
+  u_word_t rp_msk = (U_WORD(1) << cache->ccs) - U_WORD(1);
+
+  if (!(++rp_cnt & rp_msk) && _cache_seq_trylock(seq, val)) {
+    cache->rp_set(cache, set_hdr, set_dat, prb.wayi);
+    _cache_seq_unlock(seq);
+  }
+
+  return CACHE_SUCCESS;
+}
+
+int cache_read (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    u_word_t         len,
+  _Out   u_byte_t *       dat
+)
+{
+  if (cache_get_cc(cache))
+    return _cache_read_cc(cache, adr, len, dat);
+
+  return _cache_read(cache, adr, len, dat);
+}
+
+static int _cache_pin (
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             adr,
+  _In    u_word_t             len,
+  _Out   struct cache_pin_t * pin,
+  _In    int                  cnt
+)
+{
+  if (cache_get_cc(cache))
+    return CACHE_FAILURE;
+
+  struct _cache_prb_t prb;
+  u_word_t            dati;
+
+  int res = _cache_lookup(cache, adr, &len, &dati, &prb, cnt);
+
+  if (res)
+    return res;
+
+  ++*_cache_pin_cnt(cache, prb.seti, prb.wayi);
+  ++cache->pinc;
+
+  pin->dat  = _cache_way_dat(cache, prb.seti, prb.wayi);
+  pin->seti = prb.seti;
+  pin->wayi = prb.wayi;
+
+  return CACHE_SUCCESS;
+}
+
+int cache_pin (
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             adr,
+  _In    u_word_t             len,
+  _Out   struct cache_pin_t * pin
+)
+{
+  return _cache_pin(cache, adr, len, pin, 1);
+}
+
+int cache_pin_retry (
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             adr,
+  _In    u_word_t             len,
+  _Out   struct cache_pin_t * pin
+)
+{
+  return _cache_pin(cache, adr, len, pin, 0);
+}
+
+void cache_pin_dirty (
+  _InOut struct cache_t *           cache,
+  _In    const struct cache_pin_t * pin,
+  _In    u_word_t                   dati,
+  _In    u_word_t                   len
+)
+{
+  u_byte_t * way_hdr = _cache_hdr_get(cache, pin->seti);
+
+  way_hdr += pin->wayi * cache->hdrc;
+
+  if (!len || cache->datc < dati + len) {
+    len = cache->datc - dati;
+  }
+
+  cache_way_set_dirty(cache, way_hdr);
+  _cache_way_sec_write(cache, way_hdr, dati, len, 0);
+  _cache_hdr_put(cache, pin->seti);
+}
+
+void cache_unpin (
+  _InOut struct cache_t *           cache,
+  _In    const struct cache_pin_t * pin
+)
+{
+  u_word_t * cnt = _cache_pin_cnt(cache, pin->seti, pin->wayi);
+
+  /* pins dropped by a reset are released silently */
+
+  if (*cnt) {
+    --*cnt;
+    --cache->pinc;
+  }
+}
+
+int cache_part (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqc
+)
+{
+  if (
+    CACHE_RQ_MAX < rqc                       ||
+    (rqc && U_WORD(64) < cache->wayc)        ||
+    (rqc && CACHE_INDEX_SKEW == cache->idxf) ||
+    (rqc && cache_get_cc(cache))
+  ) {
+    return CACHE_FAILURE;
+  }
+
+  free(cache->own_buf);
+  free(cache->rq_buf);
+  cache->own_buf = NULL;
+  cache->rq_buf  = NULL;
+  cache->rqc     = U_WORD(0);
+  cache->rqi     = U_WORD(0);
+  cache->wmsk    = ~U_LONG(0);
+
+  if (!rqc)
+    return CACHE_SUCCESS;
+
+  cache->own_buf = (u_byte_t *)malloc((size_t)cache->smpc * cache->wayc);
+  cache->rq_buf  = (struct cache_rq_t *)calloc(
+    rqc, sizeof(struct cache_rq_t)
+  );
+
+  if (!cache->own_buf || !cache->rq_buf) {
+    free(cache->own_buf);
+    free(cache->rq_buf);
+    cache->own_buf = NULL;
+    cache->rq_buf  = NULL;
+    return CACHE_FAILURE;
+  }
+
+  u_word_t rqi, seti, wayi;
+
+  for (rqi = U_WORD(0); rqi < rqc; ++rqi) {
+    cache->rq_buf[rqi].wmsk = cache->vldm;
+  }
+
+  for (seti = U_WORD(0); seti < cache->smpc; ++seti) {
+    for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+      u_byte_t * own = _cache_rq_own(cache, seti, wayi);
+
+      *own = CACHE_RQ_NONE;
+
+      if (_cache_vld_get(cache, seti, wayi)) {
+        *own = U_BYTE(0);
+        ++cache->rq_buf[0].occc;
+      }
+    }
+  }
+
+  cache->rqc  = rqc;
+  cache->wmsk = cache->vldm;
+
+  return CACHE_SUCCESS;
+}
+
+int cache_part_mask (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqi,
+  _In    u_long_t         wmsk
+)
+{
+  if (cache->rqc <= rqi || !(wmsk & cache->vldm))
+    return CACHE_FAILURE;
+
+  cache->rq_buf[rqi].wmsk = wmsk & cache->vldm;
+
+  if (rqi == cache->rqi) {
+    cache->wmsk = cache->rq_buf[rqi].wmsk;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+int cache_part_use (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqi
+)
+{
+  if (cache->rqc <= rqi)
+    return CACHE_FAILURE;
+
+  cache->rqi  = rqi;
+  cache->wmsk = cache->rq_buf[rqi].wmsk;
+
+  return CACHE_SUCCESS;
+}
+
+void cache_part_print (
+  _In    const struct cache_t * cache,
+  _Out   FILE *                 fp
+)
+{
+  u_word_t rqi;
+
+  fprintf(
+    fp,
+    "PARTITIONS (%" U_WORD_FMTD " REQUESTORS, %" U_WORD_FMTD " LINES)\n"
+    "| %4s %18s %12s %12s %12s %9s\n",
+    cache->rqc, cache->smpc * cache->wayc,
+    "RQ", "MASK", "LINES", "ACCESSES", "MISSES", "MISS RATE"
+  );
+
+  for (rqi = U_WORD(0); rqi < cache->rqc; ++rqi) {
+    const struct cache_rq_t * rq = cache->rq_buf + rqi;
+
+    fprintf(
+      fp,
+      "| %4" U_WORD_FMTD " 0x%016" U_LONG_FMTx " %12" U_LONG_FMTD
+      " %12" U_LONG_FMTD " %12" U_LONG_FMTD " %9.6f\n",
+      rqi, rq->wmsk, rq->occc, rq->accc, rq->misc,
+      rq->accc ? (double)rq->misc / (double)rq->accc : 0.0
+    );
+  }
+}
+
+int cache_flush (
+  _InOut struct cache_t * cache,
+  _InOut u_word_t *       _seti,
+  _InOut u_word_t *       _wayi
+)
+{
+  u_word_t seti = _seti ? *_seti : U_WORD(0);
+  u_word_t wayi = _wayi ? *_wayi : U_WORD(0);
+
+  for (seti; seti < cache->smpc; ++seti) {
+    u_byte_t * set_hdr = _cache_hdr_get(cache, seti);
+    u_word_t * seq     = cache->seq_buf ? cache->seq_buf + seti : NULL;
+
+    if (seq) {
+      _cache_seq_lock(seq);
+    }
+
+    for (wayi; wayi < cache->wayc; ++wayi) {
+      u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+      u_byte_t * way_dat = _cache_way_dat(cache, seti, wayi);
+
+      if (!cache_way_get_dirty(cache, way_hdr))
+        continue;
 
-  if (!cache->dat_buf) {
-    cache->dat_buf = (u_byte_t *)malloc(
-      cache->hdr_buf ? cache->dat_len : cache->tot_len
-    );
+      int res = cache->flush(
+        cache, cache_set_logical(cache, seti), way_hdr, way_dat
+      );
 
-    if (!cache->dat_buf) {
-      cache = cache_dtor(cache);
-      return NULL;
-    }
+      if (res && seq) {
+        _cache_seq_unlock(seq);
+      }
 
-    cache_set_hm(cache);
-  }
+      if (res < 0)
+        return CACHE_FAILURE;
 
-  if (!cache->hdr_buf) {
-    cache->hdr_buf = cache->dat_buf + (
-      cache->setc * cache->dat_len
-    );
+      if (!res) {
+        cache_way_clr_dirty(cache, way_hdr);
+        memset(
+          cache_way_sec_dirty(cache, way_hdr), 0, cache->secb + cache->datb
+        );
+        _cache_hdr_put(cache, seti);
 
-    cache_set_sm(cache);
-  }
+        if (cache->evt) {
+          u_word_t set_log = cache_set_logical(cache, seti);
 
-  return cache;
-}
+          _cache_evt(
+            cache, CACHE_EVT_WRITEBACK,
+            cache_way_get_adr(cache, set_log, wayi, way_hdr),
+            seti, wayi, cache_way_get_tag(cache, way_hdr)
+          );
+        }
 
-struct cache_t * cache_dtor (
-  _InOut struct cache_t * cache
-)
-{
-  if (!cache)
-    return cache;
+        continue;
+      }
 
-  if (cache_get_hm(cache)) {
-    if (!cache->dat_buf) {
-      free(cache->dat_buf);
-      cache->dat_buf = NULL;
+      if (_seti) {
+        *_seti = seti;
+      }
+
+      if (_wayi) {
+        *_wayi = wayi;
+      }
+
+      cache_set_wf(cache);
+      return CACHE_WAITING;
     }
 
-    if (!cache_get_sm(cache)) {
-      cache->hdr_buf = NULL;
+    if (seq) {
+      _cache_seq_unlock(seq);
     }
-  }
 
-  if (cache_get_ho(cache)) {
-    free(cache);
-    cache = NULL;
+    wayi = U_WORD(0);
   }
 
-  return cache;
+  return CACHE_SUCCESS;
 }
 
-void cache_way_set_tag (
+/* built-in flush methods */
+
+int cache_flush_none (
   _InOut struct cache_t * cache,
-  _InOut u_byte_t *       way_hdr,
-  _In    u_long_t         tag
+  _In    u_word_t         seti,
+  _In    const u_byte_t * way_hdr,
+  _In    const u_byte_t * way_dat
 )
 {
-  u_byte_t * hdr = (u_byte_t *)way_hdr + 1;
+  (void)cache;
+  (void)seti;
+  (void)way_hdr;
+  (void)way_dat;
 
-  u_word_t tags = cache->tagz / U_WORD(8);
-  u_word_t tagr = cache->tagz % U_WORD(8);
-  u_word_t tagi;
+  return 0;
+}
 
-  if (tagr) {
-    u_byte_t tagm = (U_BYTE(1) << tagr) - U_BYTE(1);
+int cache_flush_print (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    const u_byte_t * way_hdr,
+  _In    const u_byte_t * way_dat
+)
+{
+  u_word_t wayi = cache_way_index(cache, way_hdr);
+  u_word_t dati;
+
+  fprintf(
+    stdout,
+    "%" U_WORD_FMTX ":%" U_WORD_FMTX " [ %c %c 0x%016" U_LONG_FMTX " |",
+    seti, wayi,
+    cache_way_get_valid(cache, way_hdr) ? 'V' : 'v',
+    cache_way_get_dirty(cache, way_hdr) ? 'D' : 'd',
+    cache_way_get_adr(cache, seti, wayi, way_hdr)
+  );
 
-    hdr[tags] = (u_byte_t)(
-      tag >> (cache->tagz - tagr)
-    ) & tagm;
+  for (dati = U_WORD(0); dati < cache->datc && way_dat; ++dati) {
+    fprintf(stdout, " %02X", way_dat[dati]);
   }
 
-  for (tagi = U_WORD(0); tagi < tags; ++tagi) {
-    hdr[tagi] = (u_byte_t)tag;
-    tag >>= 8;
-  }
+  fprintf(stdout, " ]\n");
+
+  return 0;
 }
 
-u_long_t cache_way_get_tag (
+/*
+ * built-in replacement policies, keeping their per-way state in the policy
+ * field of the header status byte
+ */
+
+int cache_rp_lru_reset (
   _InOut struct cache_t * cache,
-  _In    const u_byte_t * way_hdr
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat
 )
 {
-  u_byte_t * hdr = (u_byte_t *)way_hdr + 1;
-
-  u_long_t tag  = U_LONG(0);
-  u_word_t tags = cache->tagz / U_WORD(8);
-  u_word_t tagr = cache->tagz % U_WORD(8);
-  u_word_t tagi;
+  u_word_t wayi;
 
-  for (tagi = tags; tagi > 0; tagi) {
-    tag <<= 8;
-    tag  |= hdr[--tagi];
-  }
+  (void)set_dat;
 
-  if (!tagr)
-    return tag;
+  memset((u_byte_t *)set_hdr, 0, cache->hdr_len);
 
-  u_byte_t tagm = (U_BYTE(1) << tagr) - U_BYTE(1);
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    u_byte_t * way_hdr = (u_byte_t *)set_hdr + wayi * cache->hdrc;
 
-  tag |= (
-    (u_long_t)(hdr[tags] & tagm) << (cache->tagz - tagr)
-  );
+    cache_way_set_rp(cache, way_hdr, wayi);
+  }
 
-  return tag;
+  return 0;
 }
 
-int cache_reset (
+int cache_rp_lru_set (
   _InOut struct cache_t * cache,
-  _InOut u_word_t *       _seti
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _In    u_word_t         mru_wayi
 )
 {
-  u_word_t seti = _seti ? *_seti : U_WORD(0);
+  u_byte_t * mru_way_hdr = (u_byte_t *)set_hdr + mru_wayi * cache->hdrc;
+  u_word_t   mru_way_rp  = cache_way_get_rp(cache, mru_way_hdr);
+  u_word_t   wayi;
 
-  for (seti; seti < cache->setc; ++seti) {
-    u_byte_t * set_hdr = cache->hdr_buf + seti * cache->hdr_len;
-    u_byte_t * set_dat = cache->dat_buf + seti * cache->dat_len;
+  (void)set_dat;
 
-    int res = cache->rp_reset(cache, set_hdr, set_dat);
-
-    if (res < 0)
-      return CACHE_FAILURE;
+  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
+    u_byte_t * way_hdr = (u_byte_t *)set_hdr + wayi * cache->hdrc;
+    u_word_t   way_rp  = cache_way_get_rp(cache, way_hdr);
 
-    if (!res)
+    if (way_rp <= mru_way_rp)
       continue;
 
-    if (_seti) {
-      *_seti = seti;
-    }
-
-    cache_set_wr(cache);
-    return CACHE_WAITING;
+    cache_way_set_rp(cache, way_hdr, way_rp - U_WORD(1));
   }
 
-  return CACHE_SUCCESS;
+  cache_way_set_rp(cache, mru_way_hdr, cache->wayc - U_WORD(1));
+
+  return 0;
 }
 
-int cache_write (
+int cache_rp_lru_get (
   _InOut struct cache_t * cache,
-  _In    u_long_t         adr,
-  _In    u_word_t         len,
-  _In    const u_byte_t * dat
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _Out   u_word_t *       _wayi
 )
 {
-  if (cache_get_wr(cache) || cache_get_wf(cache))
-    return CACHE_WAITING;
-
-  u_long_t tag  = (u_long_t)(adr >> cache->tags) & cache->tagm;
-  u_word_t seti = (u_word_t)(adr >> cache->sets) & cache->setm;
+  u_word_t vic_wayi = cache->wayc;
+  u_word_t vic_rp   = cache->wayc;
   u_word_t wayi;
-  u_word_t dati = (u_word_t)(adr >> cache->dats) & cache->datm;
 
-  if (!len || cache->datc < dati + len) {
-    len = cache->datc - dati;
-  }
+  (void)set_dat;
 
-  u_byte_t * set_hdr = cache->hdr_buf + seti * cache->hdr_len;
-  u_byte_t * set_dat = cache->dat_buf + seti * cache->dat_len;
+  /* the least recent of the permitted ways */
 
-  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
-    u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
-    u_byte_t * way_dat = set_dat + wayi * cache->datc;
+  for (wayi = U_WORD(0); wayi < cache->wayc && vic_rp; ++wayi) {
+    const u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
+    u_word_t         way_rp  = cache_way_get_rp(cache, way_hdr);
 
-    if (!cache_way_get_valid(cache, way_hdr))
+    if (!cache_way_permitted(cache, wayi) || vic_rp <= way_rp)
       continue;
 
-    u_long_t way_tag = cache_way_get_tag(cache, way_hdr);
+    vic_wayi = wayi;
+    vic_rp   = way_rp;
+  }
 
-    if (way_tag != tag)
-      continue;
+  if (vic_wayi == cache->wayc)
+    return -1;
 
-    memcpy(way_dat + dati, dat, len);
-    cache_way_set_dirty(cache, way_hdr);
-    cache->rp_set(cache, set_hdr, set_dat, wayi);
+  *_wayi = vic_wayi;
+  return 0;
+}
 
-    return CACHE_SUCCESS;
-  }
+/* tree PLRU: node `n` of the heap-ordered tree lives in way `n - 1` */
 
-  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
-    u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
-    u_byte_t * way_dat = set_dat + wayi * cache->datc;
+int cache_rp_plru_reset (
+  _InOut struct cache_t * cache,
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat
+)
+{
+  (void)set_dat;
 
-    if (cache_way_get_valid(cache, way_hdr))
-      continue;
+  memset((u_byte_t *)set_hdr, 0, cache->hdr_len);
 
-    memcpy(way_dat + dati, dat, len);
-    cache_way_set_valid(cache, way_hdr);
-    cache_way_set_dirty(cache, way_hdr);
-    cache_way_set_tag(cache, way_hdr, tag);
-    cache->rp_set(cache, set_hdr, set_dat, wayi);
+  return 0;
+}
 
-    return CACHE_SUCCESS;
-  }
+int cache_rp_plru_set (
+  _InOut struct cache_t * cache,
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _In    u_word_t         wayi
+)
+{
+  u_word_t node = U_WORD(1);
+  u_word_t bitc;
 
-  int res = cache->rp_get(cache, set_hdr, set_dat, &wayi);
+  (void)set_dat;
 
-  if (res)
-    return CACHE_FAILURE;
+  for (bitc = cache->wayc >> 1; bitc; bitc >>= 1) {
+    u_byte_t * way_hdr = (u_byte_t *)set_hdr + (node - 1) * cache->hdrc;
+    u_word_t   dir     = (wayi & bitc) ? U_WORD(1) : U_WORD(0);
 
-  u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
-  u_byte_t * way_dat = set_dat + wayi * cache->datc;
+    /* point the node away from the accessed way */
 
-  memcpy(way_dat + dati, dat, len);
-  cache_way_set_valid(cache, way_hdr);
-  cache_way_set_dirty(cache, way_hdr);
-  cache_way_set_tag(cache, way_hdr, tag);
-  cache->rp_set(cache, set_hdr, set_dat, wayi);
+    cache_way_set_rp(cache, way_hdr, dir ^ U_WORD(1));
+    node = (node << 1) | dir;
+  }
 
-  return CACHE_SUCCESS;
+  return 0;
 }
 
-int cache_read (
+int cache_rp_plru_get (
   _InOut struct cache_t * cache,
-  _In    u_long_t         adr,
-  _In    u_word_t         len,
-  _Out   u_byte_t *       dat
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _Out   u_word_t *       _wayi
 )
 {
-  if (cache_get_wr(cache) || cache_get_wf(cache))
-    return CACHE_WAITING;
+  u_word_t node = U_WORD(1);
+  u_word_t wayi = U_WORD(0);
+  u_word_t bitc;
 
-  u_long_t tag  = (u_long_t)(adr >> cache->tags) & cache->tagm;
-  u_word_t seti = (u_word_t)(adr >> cache->sets) & cache->setm;
-  u_word_t wayi;
-  u_word_t dati = (u_word_t)(adr >> cache->dats) & cache->datm;
+  (void)set_dat;
 
-  if (!len || cache->datc < dati + len) {
-    len = cache->datc - dati;
-  }
+  for (bitc = cache->wayc >> 1; bitc; bitc >>= 1) {
+    const u_byte_t * way_hdr = set_hdr + (node - 1) * cache->hdrc;
+    u_word_t         dir     = cache_way_get_rp(cache, way_hdr) & 1;
 
-  u_byte_t * set_hdr = cache->hdr_buf + seti * cache->hdr_len;
-  u_byte_t * set_dat = cache->dat_buf + seti * cache->dat_len;
+    /* turn away from a subtree without permitted ways */
 
-  for (wayi = U_WORD(0); wayi < cache->wayc; ++wayi) {
-    u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
-    u_byte_t * way_dat = set_dat + wayi * cache->datc;
+    if (cache->rqc) {
+      u_long_t sub = (U_LONG(1) << bitc) - U_LONG(1);
 
-    if (!cache_way_get_valid(cache, way_hdr))
-      continue;
+      if (!(cache->wmsk & sub << (((wayi << 1) | dir) * bitc))) {
+        dir ^= U_WORD(1);
+      }
+    }
 
-    u_long_t way_tag = cache_way_get_tag(cache, way_hdr);
+    wayi = (wayi << 1) | dir;
+    node = (node << 1) | dir;
+  }
 
-    if (way_tag != tag)
-      continue;
+  *_wayi = wayi;
+  return 0;
+}
 
-    memcpy(dat, way_dat + dati, len);
-    cache->rp_set(cache, set_hdr, set_dat, wayi);
+int cache_rp_random_reset (
+  _InOut struct cache_t * cache,
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat
+)
+{
+  (void)set_dat;
 
-    return CACHE_SUCCESS;
-  }
+  memset((u_byte_t *)set_hdr, 0, cache->hdr_len);
 
-  return CACHE_FAILURE;
+  return 0;
 }
 
-int cache_flush (
+int cache_rp_random_set (
   _InOut struct cache_t * cache,
-  _InOut u_word_t *       _seti,
-  _InOut u_word_t *       _wayi
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _In    u_word_t         wayi
 )
 {
-  u_word_t seti = _seti ? *_seti : U_WORD(0);
-  u_word_t wayi = _wayi ? *_wayi : U_WORD(0);
+  (void)cache;
+  (void)set_hdr;
+  (void)set_dat;
+  (void)wayi;
 
-  for (seti; seti < cache->setc; ++seti) {
-    u_byte_t * set_hdr = cache->hdr_buf + seti * cache->hdr_len;
-    u_byte_t * set_dat = cache->dat_buf + seti * cache->dat_len;
+  return 0;
+}
 
-    for (wayi; wayi < cache->wayc; ++wayi) {
-      u_byte_t * way_hdr = set_hdr + wayi * cache->hdrc;
-      u_byte_t * way_dat = set_dat + wayi * cache->datc;
+/*
+ * splitmix64 over the cache's own state, so that caches replayed side by
+ * side draw independent and repeatable victims; the state is stepped
+ * atomically since concurrent writers evict in different sets at once.
+ */
 
-      if (!cache_way_get_dirty(cache, way_hdr))
-        continue;
+static u_word_t _cache_rp_random_next (
+  _InOut struct cache_t * cache
+)
+{
+  u_long_t rnd = __atomic_add_fetch(
+    &cache->rnd, U_LONG(0x9E3779B97F4A7C15), __ATOMIC_RELAXED
+  );
 
-      int res = cache->flush(cache, seti, way_hdr, way_dat);
+  rnd = (rnd ^ (rnd >> 30)) * U_LONG(0xBF58476D1CE4E5B9);
+  rnd = (rnd ^ (rnd >> 27)) * U_LONG(0x94D049BB133111EB);
 
-      if (res < 0)
-        return CACHE_FAILURE;
+  return (u_word_t)((rnd ^ (rnd >> 31)) >> 32);
+}
 
-      if (!res) {
-        cache_way_clr_dirty(cache, way_hdr);
-        continue;
-      }
+int cache_rp_random_get (
+  _InOut struct cache_t * cache,
+  _In    const u_byte_t * set_hdr,
+  _In    const u_byte_t * set_dat,
+  _Out   u_word_t *       _wayi
+)
+{
+  (void)set_hdr;
+  (void)set_dat;
 
-      if (_seti) {
-        *_seti = seti;
-      }
+  if (cache->rqc) {
+    u_long_t msk = cache->wmsk;
+    u_word_t rnd = (
+      _cache_rp_random_next(cache) % (u_word_t)__builtin_popcountll(msk)
+    );
 
-      if (_wayi) {
-        *_wayi = wayi;
+    for (; rnd; --rnd) {
+      msk &= msk - U_LONG(1);
+    }
+
+    *_wayi = (u_word_t)__builtin_ctzll(msk);
+    return 0;
+  }
+
+  *_wayi = _cache_rp_random_next(cache) % cache->wayc;
+  return 0;
+}
+
+void cache_stat (
+  _In    const struct cache_t * cache,
+  _Out   struct cache_stat_t *  stat
+)
+{
+  u_long_t rd_hitc = _cache_cnt_get(cache, _CACHE_CNT_RD_HIT);
+  u_long_t rd_misc = _cache_cnt_get(cache, _CACHE_CNT_RD_MIS);
+  u_long_t wr_hitc = _cache_cnt_get(cache, _CACHE_CNT_WR_HIT);
+  u_long_t wr_misc = _cache_cnt_get(cache, _CACHE_CNT_WR_MIS);
+  u_long_t wp_hitc = _cache_cnt_get(cache, _CACHE_CNT_WP_HIT);
+  u_long_t wp_misc = _cache_cnt_get(cache, _CACHE_CNT_WP_MIS);
+  u_long_t wp_prbc = _cache_cnt_get(cache, _CACHE_CNT_WP_PRB);
+
+  stat->accc = rd_hitc + rd_misc + wr_hitc + wr_misc;
+  stat->misc = rd_misc + wr_misc;
+  stat->skpc = _cache_cnt_get(cache, _CACHE_CNT_SKP);
+
+  stat->est_accc    = (double)(stat->accc + stat->skpc);
+  stat->mis_rate    = 0.0;
+  stat->mis_rate_lo = 0.0;
+  stat->mis_rate_hi = 0.0;
+
+  if (stat->accc) {
+    /*
+     * The miss rate of the sampled sets is a ratio estimator of the full
+     * cache miss rate, each stored set a cluster of accesses. Its variance
+     * comes from how far every set strays from the overall rate, scaled by
+     * the fraction of sets left out; a single stored set gives no estimate.
+     * With `smpz == 0` every set is simulated and the rate is exact.
+     */
+
+    double p = (double)stat->misc / (double)stat->accc;
+    double e = 0.0;
+
+    if (cache->smp_buf && cache->smpc < U_WORD(2)) {
+      e = 1.0;
+    } else if (cache->smp_buf) {
+      double n = (double)cache->smpc;
+      double a = (double)stat->accc / n;
+      double v = 0.0;
+      u_word_t seti;
+
+      for (seti = U_WORD(0); seti < cache->smpc; ++seti) {
+        double d = (double)__atomic_load_n(
+          cache->smp_buf + U_WORD(2) * seti + 1, __ATOMIC_RELAXED
+        ) - p * (double)__atomic_load_n(
+          cache->smp_buf + U_WORD(2) * seti, __ATOMIC_RELAXED
+        );
+
+        v += d * d;
       }
 
-      cache_set_wf(cache);
-      return CACHE_WAITING;
+      v *= (1.0 - n / (double)cache->setc) / (n * (n - 1.0) * a * a);
+      e  = 1.96 * sqrt(v);
     }
 
-    wayi = U_WORD(0);
+    stat->mis_rate    = p;
+    stat->mis_rate_lo = p - e < 0.0 ? 0.0 : p - e;
+    stat->mis_rate_hi = p + e > 1.0 ? 1.0 : p + e;
   }
 
-  return CACHE_SUCCESS;
+  stat->est_misc = stat->mis_rate * stat->est_accc;
+
+  u_long_t wp_accc = wp_hitc + wp_misc;
+
+  stat->wp_rate     = wp_accc ? (double)wp_hitc / wp_accc : 0.0;
+  stat->wp_prb_rate = wp_accc ? (double)wp_prbc / wp_accc : 0.0;
+}
+
+void cache_stat_print (
+  _In    const struct cache_t * cache,
+  _Out   FILE *                 fp
+)
+{
+  struct cache_stat_t stat;
+  cache_stat(cache, &stat);
+
+  fprintf(
+    fp,
+    "SAMPLED 1/%" U_WORD_FMTD " SETS\n"
+    "| ACCESSES %" U_LONG_FMTD " (SKIPPED %" U_LONG_FMTD ")\n"
+    "| MISSES   %" U_LONG_FMTD "\n"
+    "| EST. ACCESSES %.0f\n"
+    "| EST. MISSES   %.0f\n"
+    "| MISS RATE     %.6f [%.6f, %.6f]\n",
+    U_WORD(1) << cache->smpz,
+    stat.accc, stat.skpc,
+    stat.misc,
+    stat.est_accc,
+    stat.est_misc,
+    stat.mis_rate, stat.mis_rate_lo, stat.mis_rate_hi
+  );
+
+  if (cache_get_wp(cache)) {
+    fprintf(
+      fp,
+      "| WAY PREDICTION %.6f (%.3f PROBES PER HIT)\n",
+      stat.wp_rate, stat.wp_prb_rate
+    );
+  }
 }
 
 struct cache_test_t * cache_test_ctor (
@@ -428,7 +3439,7 @@ struct cache_test_t * cache_test_ctor (
     test->setv = NULL;
     cache_test_set_ho(test);
   } else {
-    if (cache->setc != test->setc)
+    if (cache->smpc != test->setc)
       return NULL;
 
     test->sr = 0;
@@ -436,7 +3447,7 @@ struct cache_test_t * cache_test_ctor (
 
   if (!test->setv) {
     test->setv = (u_word_t *)calloc(
-      sizeof(u_word_t), cache->setc
+      sizeof(u_word_t), cache->smpc
     );
 
     if (!test->setv) {
@@ -447,7 +3458,7 @@ struct cache_test_t * cache_test_ctor (
     cache_test_set_hm(test);
   }
 
-  test->setc  = cache->setc;
+  test->setc  = cache->smpc;
   test->cache = cache;
 
   return test;
@@ -488,6 +3499,13 @@ static void _cache_test_rand_dat (
   _Out   u_byte_t *            buf
 );
 
+static int _cache_test_write (
+  _InOut struct cache_test_t * test,
+  _In    u_long_t              adr,
+  _In    u_word_t              len,
+  _In    const u_byte_t *      buf
+);
+
 static void _cache_test_print (
   _Out FILE *       fp,
   _In  const char * fmt,
@@ -515,10 +3533,12 @@ int cache_test_run (
   u_word_t cc_res [M];
 
   for (seti = U_WORD(0); seti < test->setc; ++seti) {
+    u_word_t setl = cache_set_logical(test->cache, seti);
+
     _cache_test_print(
       fp,
       "| SET %" U_WORD_FMTD "\n",
-      seti
+      setl
     );
 
     memset(cc_res, 0, M * sizeof(u_word_t));
@@ -532,7 +3552,7 @@ int cache_test_run (
         wayi
       );
 
-      u_long_t adr = _cache_test_rand_adr(test, &seti, NULL);
+      u_long_t adr = _cache_test_rand_adr(test, &setl, NULL);
 
       memset(wr_buf, 0, N);
       memset(rd_buf, 0, N);
@@ -540,7 +3560,7 @@ int cache_test_run (
       u_word_t len = U_WORD(0);
       _cache_test_rand_dat(test, adr, &len, wr_buf);
 
-      int wr_res = cache_write(test->cache, adr, len, wr_buf);
+      int wr_res = _cache_test_write(test, adr, len, wr_buf);
 
       _cache_test_print(
         fp,
@@ -578,7 +3598,7 @@ int cache_test_run (
         wayi
       );
 
-      u_long_t adr = _cache_test_rand_adr(test, &seti, NULL);
+      u_long_t adr = _cache_test_rand_adr(test, &setl, NULL);
 
       memset(wr_buf, 0, N);
       memset(rd_buf, 0, N);
@@ -586,7 +3606,7 @@ int cache_test_run (
       u_word_t len = U_WORD(0);
       _cache_test_rand_dat(test, adr, &len, wr_buf);
 
-      int wr_res = cache_write(test->cache, adr, len, wr_buf);
+      int wr_res = _cache_test_write(test, adr, len, wr_buf);
 
       _cache_test_print(
         fp,
@@ -626,7 +3646,7 @@ static u_long_t _cache_test_rand_adr (
   _In    const u_word_t *      _dati
 )
 {
-  u_word_t seti = _seti ? *_seti : ((u_word_t)rand() & test->cache->setm);
+  u_word_t seti = _seti ? *_seti : ((u_word_t)rand() % test->cache->setc);
   u_word_t dati = _dati ? *_dati : ((u_word_t)rand() & test->cache->datm);
   u_word_t tagl = (u_word_t)rand();
   u_word_t tagh = (u_word_t)rand();
@@ -635,8 +3655,7 @@ static u_long_t _cache_test_rand_adr (
   ) & test->cache->tagm;
 
   u_long_t adr  = (
-    (tag  << test->cache->tags) |
-    (seti << test->cache->sets) |
+    cache_adr(test->cache, seti, U_WORD(0), tag) |
     (dati << test->cache->dats)
   );
 
@@ -663,6 +3682,32 @@ static void _cache_test_rand_dat (
   }
 }
 
+/* a partial write miss is filled from a zeroed next level, then retried */
+
+static int _cache_test_write (
+  _InOut struct cache_test_t * test,
+  _In    u_long_t              adr,
+  _In    u_word_t              len,
+  _In    const u_byte_t *      buf
+)
+{
+  int res = cache_write(test->cache, adr, len, buf);
+
+  if (CACHE_FAILURE == res) {
+    u_byte_t lin_buf [test->cache->datc];
+
+    memset(lin_buf, 0, test->cache->datc);
+
+    res = cache_fill(test->cache, adr, lin_buf);
+
+    if (!res) {
+      res = cache_write(test->cache, adr, len, buf);
+    }
+  }
+
+  return res;
+}
+
 static void _cache_test_print (
   _Out FILE *       fp,
   _In  const char * fmt,
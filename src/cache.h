@@ -89,6 +89,7 @@ struct cache_test_t;
 #   define CACHE_FAILURE -1
 #   define CACHE_SUCCESS  0
 #   define CACHE_WAITING +1
+#   define CACHE_SKIPPED +2
 
 #   define CACHE_TEST_FAILED  -1
 #   define CACHE_TEST_PASSED   0
@@ -96,6 +97,9 @@ struct cache_test_t;
 
 struct cache_t {
   u_word_t   sr;
+  u_word_t   cr;
+  u_long_t   map_len;
+  u_byte_t * map_buf;
   u_word_t   tot_len;
   u_word_t   dat_len;
   u_byte_t * dat_buf;
@@ -112,6 +116,54 @@ struct cache_t {
   u_word_t   datc; /* in bytes */
   u_word_t   tagz; /* in bits  */
   u_word_t   hdrc; /* in bytes */
+  u_word_t   smpz; /* in bits  */
+  u_word_t   smpo; /* in sets  */
+  u_word_t   smpc; /* in sets  */
+  u_word_t   smpm;
+  u_word_t   secc; /* in sectors */
+  u_word_t   secs; /* in bits    */
+  u_word_t   secp; /* in bytes   */
+  u_word_t   secb; /* in bytes   */
+  u_word_t   datb; /* in bytes   */
+  u_word_t   idxf;
+  u_word_t   idxz; /* in bits    */
+  u_word_t   bnkc; /* in banks   */
+  u_word_t   ccs;  /* in bits    */
+  u_word_t   pkb;  /* in bits    */
+  u_word_t   pkz;  /* in bytes   */
+  u_word_t   rpb;  /* in bits    */
+  u_byte_t * upk_buf;
+  u_word_t * seq_buf;
+  u_long_t * cnt_buf;   /* counter slots, concurrent mode */
+  u_long_t * smp_buf;   /* accesses and misses per stored set, sampling */
+  u_word_t * wpr_buf;
+  u_long_t * vld_buf;
+  u_word_t   vldz; /* in words   */
+  u_long_t   vldm;
+  u_byte_t * ptg_buf;
+  u_word_t   ptgz; /* in bytes   */
+  u_long_t   ptgm;
+  u_word_t * pin_buf;
+  u_long_t   pinc;      /* outstanding pins */
+  u_word_t   rqc;       /* requestors, none when not partitioned */
+  u_word_t   rqi;       /* current requestor */
+  u_long_t   wmsk;      /* ways it may fill  */
+  u_byte_t * own_buf;
+
+  struct cache_rq_t * rq_buf;
+
+  struct cache_evt_t * evt;
+  struct cache_c3_t *  c3;
+
+  u_long_t   rd_hitc;
+  u_long_t   rd_misc;
+  u_long_t   wr_hitc;
+  u_long_t   wr_misc;
+  u_long_t   skpc;
+  u_long_t   wp_hitc; /* hits on the predicted way  */
+  u_long_t   wp_misc; /* hits on another way        */
+  u_long_t   wp_prbc; /* ways probed by those hits  */
+  u_long_t   rnd;     /* random policy state, `--seed` */
 
   int ( * flush ) (
     _InOut struct cache_t * /* cache   */,
@@ -120,6 +172,15 @@ struct cache_t {
     _In    const u_byte_t * /* way_dat */
   );
 
+  /* optional: writes back a dirty victim before it is replaced */
+
+  int ( * evict ) (
+    _InOut struct cache_t * /* cache   */,
+    _In    u_word_t         /* seti    */,
+    _In    const u_byte_t * /* way_hdr */,
+    _In    const u_byte_t * /* way_dat */
+  );
+
   int ( * rp_reset ) (
     _InOut struct cache_t * /* cache   */,
     _In    const u_byte_t * /* set_hdr */,
@@ -141,23 +202,117 @@ struct cache_t {
   );
 };
 
+/* `wr` and `wf` are raised by writers while readers test them */
+
 #   define cache_clr_ho(cache) (cache)->sr &= ~0x1
 #   define cache_clr_hm(cache) (cache)->sr &= ~0x2
 #   define cache_clr_sm(cache) (cache)->sr &= ~0x4
-#   define cache_clr_wr(cache) (cache)->sr &= ~0x10
-#   define cache_clr_wf(cache) (cache)->sr &= ~0x20
+#   define cache_clr_mm(cache) (cache)->sr &= ~0x8
+#   define cache_clr_wr(cache) \
+    __atomic_fetch_and(&(cache)->sr, ~U_WORD(0x10), __ATOMIC_RELAXED)
+#   define cache_clr_wf(cache) \
+    __atomic_fetch_and(&(cache)->sr, ~U_WORD(0x20), __ATOMIC_RELAXED)
 
 #   define cache_set_ho(cache) (cache)->sr |= 0x1
 #   define cache_set_hm(cache) (cache)->sr |= 0x2
 #   define cache_set_sm(cache) (cache)->sr |= 0x4
-#   define cache_set_wr(cache) (cache)->sr |= 0x10
-#   define cache_set_wf(cache) (cache)->sr |= 0x20
+#   define cache_set_mm(cache) (cache)->sr |= 0x8
+#   define cache_set_wr(cache) \
+    __atomic_fetch_or(&(cache)->sr, U_WORD(0x10), __ATOMIC_RELAXED)
+#   define cache_set_wf(cache) \
+    __atomic_fetch_or(&(cache)->sr, U_WORD(0x20), __ATOMIC_RELAXED)
 
 #   define cache_get_ho(cache) ((cache)->sr & 0x1)
 #   define cache_get_hm(cache) ((cache)->sr & 0x2)
 #   define cache_get_sm(cache) ((cache)->sr & 0x4)
-#   define cache_get_wr(cache) ((cache)->sr & 0x10)
-#   define cache_get_wf(cache) ((cache)->sr & 0x20)
+#   define cache_get_mm(cache) ((cache)->sr & 0x8)
+#   define cache_get_wr(cache) \
+    (__atomic_load_n(&(cache)->sr, __ATOMIC_RELAXED) & 0x10)
+#   define cache_get_wf(cache) \
+    (__atomic_load_n(&(cache)->sr, __ATOMIC_RELAXED) & 0x20)
+
+/*
+ * Set index functions, selected by `idxf`:
+ *   BITS  - `(adr >> sets) & setm`, the default;
+ *   XOR   - the set bits XOR-folded with the tag;
+ *   PRIME - the line address modulo `setc`, which may be any set count
+ *           (the tag keeps the quotient);
+ *   SKEW  - XOR-folding with a different hash for each of the `bnkc` way
+ *           banks, so a line maps to a different set in every bank.
+ * XOR and SKEW need a power-of-two `setc`. The tag is always stored so
+ * that `cache_adr` can rebuild the line address for writeback. The options
+ * `--index` and `--sets` set `idxf`, `bnkc` and `setc`; a `setc` that is
+ * not a power of two has `tags` rounded up and a `tagz` one bit wider than
+ * the address above `tags`, for the quotient.
+ */
+
+#   define CACHE_INDEX_BITS  0
+#   define CACHE_INDEX_XOR   1
+#   define CACHE_INDEX_PRIME 2
+#   define CACHE_INDEX_SKEW  3
+
+/*
+ * Control register, set by the caller before `cache_ctor`:
+ *   cc - concurrent mode. Each stored set gets a sequence lock: readers
+ *        probe without locking and retry when a writer changed the set,
+ *        writers (write, fill, flush, reset) lock the set they modify.
+ *        A read hit updates the policy only for one hit in `1 << ccs`
+ *        per thread, and only if the set lock is free at that time.
+ *        Statistics go to per-thread slots of the cache: `cache_stat`
+ *        includes them, and `cache_cc_sync` folds them into the counter
+ *        fields, which the caller should do before reading the fields
+ *        directly. Not available with skewed indexing.
+ *   wp - way prediction. Reads and writes probe the most recently used
+ *        way of the set first and fall back to the other ways; accuracy
+ *        and probes per hit are reported by `cache_stat`. Not available
+ *        with skewed indexing.
+ *   pt - partial tags. Each set keeps an 8-bit hash of every way's tag,
+ *        so most misses are rejected by a word-wide compare before any
+ *        tag is decoded. Tags must only change through the cache calls.
+ *        Not available with skewed indexing.
+ *   to - tag-only mode, also set by `--tags-only`. No data array is
+ *        allocated and `dat_len` is zero: only tags, state and policy
+ *        metadata are kept. The data pointers of `cache_read`,
+ *        `cache_write` and `cache_fill` may be NULL and are ignored, the
+ *        callbacks get NULL data and pins have no `dat`.
+ *   ph - packed headers, also set by `--packed`. Each way takes exactly
+ *        `pkb` bits of `hdr_buf`: valid, dirty, `rpb` policy bits (what
+ *        the built-in policy needs, six for a custom one) and the tag.
+ *        A set takes `pkz` bytes, a power of two up to a 64-byte host
+ *        cache line and whole lines beyond, so no set straddles a line.
+ *        Tags are compared in place; callbacks get the set unpacked in
+ *        the usual layout, `hdrc` bytes per way, which is packed back
+ *        after them, so way header pointers are only valid during a
+ *        callback. Not available with sectors, extra header bits or
+ *        concurrent mode. A loaded packed checkpoint keeps its `rpb`,
+ *        so install the policy it was saved with.
+ */
+
+#   define cache_clr_cc(cache) (cache)->cr &= ~0x1
+#   define cache_clr_wp(cache) (cache)->cr &= ~0x2
+#   define cache_clr_pt(cache) (cache)->cr &= ~0x4
+#   define cache_clr_to(cache) (cache)->cr &= ~0x8
+#   define cache_clr_ph(cache) (cache)->cr &= ~0x10
+
+#   define cache_set_cc(cache) (cache)->cr |= 0x1
+#   define cache_set_wp(cache) (cache)->cr |= 0x2
+#   define cache_set_pt(cache) (cache)->cr |= 0x4
+#   define cache_set_to(cache) (cache)->cr |= 0x8
+#   define cache_set_ph(cache) (cache)->cr |= 0x10
+
+#   define cache_get_cc(cache) ((cache)->cr & 0x1)
+#   define cache_get_wp(cache) ((cache)->cr & 0x2)
+#   define cache_get_pt(cache) ((cache)->cr & 0x4)
+#   define cache_get_to(cache) ((cache)->cr & 0x8)
+#   define cache_get_ph(cache) ((cache)->cr & 0x10)
+
+/*
+ * A NULL `cache` is allocated and zeroed. A cache passed by the caller
+ * must be zeroed before its geometry and options are set, e.g. with
+ * `struct cache_t cache = { 0 }`: besides the geometry the ctor reads
+ * `cr`, `secc`, `smpz`, `smpo`, `idxf`, `bnkc` and `ccs` as inputs, and a
+ * field left as garbage selects a mode nobody asked for.
+ */
 
 struct cache_t * cache_ctor (
   _InOut struct cache_t * cache,
@@ -169,6 +324,28 @@ struct cache_t * cache_dtor (
   _InOut struct cache_t * cache
 );
 
+/*
+ * Checkpoint file: a fixed header followed by the data and header arrays
+ * laid out exactly as `dat_buf` and `hdr_buf`. The file is native-endian
+ * and is mapped copy-on-write by `cache_load`, so no parsing is done.
+ * Callbacks are not saved: the caller installs them after loading.
+ * A `cache` passed to `cache_load` must be zeroed or constructed; once the
+ * file is mapped whatever it owned is released and it is reloaded in place.
+ */
+
+#   define CACHE_CKPT_MAGIC   "HWCACHE"
+#   define CACHE_CKPT_VERSION 6
+
+int cache_save (
+  _In    struct cache_t * cache,
+  _In    const char *     path
+);
+
+struct cache_t * cache_load (
+  _InOut struct cache_t * cache,
+  _In    const char *     path
+);
+
 #   define cache_way_clr_valid(cache, way_hdr) (way_hdr)[0] &= ~0x1
 #   define cache_way_clr_dirty(cache, way_hdr) (way_hdr)[0] &= ~0x2
 
@@ -178,6 +355,49 @@ struct cache_t * cache_dtor (
 #   define cache_way_get_valid(cache, way_hdr) ((way_hdr)[0] & 0x1)
 #   define cache_way_get_dirty(cache, way_hdr) ((way_hdr)[0] & 0x2)
 
+/* policy field: the upper six bits of the status byte */
+
+#   define CACHE_RP_MAX 64
+
+#   define cache_way_get_rp(cache, way_hdr) \
+    ((u_word_t)((way_hdr)[0] >> 2))
+#   define cache_way_set_rp(cache, way_hdr, rp) \
+    (way_hdr)[0] = (u_byte_t)(((way_hdr)[0] & 0x3) | ((rp) << 2))
+
+/*
+ * Sectored lines: when `secc` is greater than one, each line is split in
+ * `secc` sectors of `1 << secs` bytes and `cache_ctor` appends a valid and
+ * a dirty mask of `secb` bytes each at offset `secp` of the way header,
+ * then a mask of `datb` bytes with one bit per written byte.
+ * A sector becomes valid only when it is written whole; reads hit only
+ * when every requested sector is valid. A fill completes the sectors that
+ * are not valid, keeping the bytes written to them. The `flush` callback
+ * should write back the dirty sectors only, and of a dirty sector that is
+ * not valid only the written bytes; the masks are cleared after it
+ * succeeds.
+ *
+ * Without sectors a write miss that covers part of the line, with data, is
+ * not allocated: it counts as a write miss and returns CACHE_FAILURE for
+ * the caller to write around the cache, or to fill the line and write
+ * again. Without data there is nothing stale and the line is allocated.
+ */
+
+#   define cache_way_sec_valid(cache, way_hdr) \
+    ((way_hdr) + (cache)->secp)
+#   define cache_way_sec_dirty(cache, way_hdr) \
+    ((way_hdr) + (cache)->secp + (cache)->secb)
+
+#   define cache_way_get_sec_valid(cache, way_hdr, seci)      \
+    ((cache_way_sec_valid(cache, way_hdr)[(seci) >> 3] >> ((seci) & 7)) & 1)
+#   define cache_way_get_sec_dirty(cache, way_hdr, seci)      \
+    ((cache_way_sec_dirty(cache, way_hdr)[(seci) >> 3] >> ((seci) & 7)) & 1)
+
+#   define cache_way_dat_dirty(cache, way_hdr) \
+    ((way_hdr) + (cache)->secp + U_WORD(2) * (cache)->secb)
+
+#   define cache_way_get_dat_dirty(cache, way_hdr, dati)      \
+    ((cache_way_dat_dirty(cache, way_hdr)[(dati) >> 3] >> ((dati) & 7)) & 1)
+
 void cache_way_set_tag (
   _InOut struct cache_t * cache,
   _InOut u_byte_t *       way_hdr,
@@ -189,6 +409,27 @@ u_long_t cache_way_get_tag (
   _In    const u_byte_t * way_hdr
 );
 
+#   define cache_way_index(cache, way_hdr)                          \
+    ((u_word_t)(                                                 \
+      (u_long_t)((way_hdr) - (                                   \
+        cache_get_ph(cache) ? (cache)->upk_buf : (cache)->hdr_buf \
+      )) % (cache)->hdr_len / (cache)->hdrc                      \
+    ))
+
+u_long_t cache_adr (
+  _In    const struct cache_t * cache,
+  _In    u_word_t               seti,
+  _In    u_word_t               wayi,
+  _In    u_long_t               tag
+);
+
+u_long_t cache_way_get_adr (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    u_word_t         wayi,
+  _In    const u_byte_t * way_hdr
+);
+
 int cache_reset (
   _InOut struct cache_t * cache,
   _InOut u_word_t *       _seti
@@ -201,6 +442,17 @@ int cache_write (
   _In    const u_byte_t * dat
 );
 
+/*
+ * Install a clean line read from the next level. A line already present
+ * keeps its data, except for the sectors that are neither valid nor dirty.
+ */
+
+int cache_fill (
+  _InOut struct cache_t * cache,
+  _In    u_long_t         adr,
+  _In    const u_byte_t * dat
+);
+
 int cache_read (
   _InOut struct cache_t * cache,
   _In    u_long_t         adr,
@@ -208,12 +460,228 @@ int cache_read (
   _Out   u_byte_t *       dat
 );
 
+/*
+ * Zero-copy access: `cache_pin` looks `adr` up like `cache_read` but, on a
+ * hit, hands out the line in place instead of copying it. A pinned line is
+ * never evicted; a miss whose every candidate way is pinned returns
+ * CACHE_WAITING until a pin is released. Bytes modified through `pin->dat`
+ * must be reported with `cache_pin_dirty` before `cache_unpin`. Resetting
+ * a set drops its pins. Not available in concurrent mode.
+ *
+ * `cache_pin_retry` pins the line of a miss the caller has just filled;
+ * the miss already counted the access, so the retry adds no hit, no
+ * statistic and no event.
+ */
+
+struct cache_pin_t {
+  u_byte_t * dat;  /* line data in `dat_buf` */
+  u_word_t   seti; /* stored set             */
+  u_word_t   wayi;
+};
+
+int cache_pin (
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             adr,
+  _In    u_word_t             len,
+  _Out   struct cache_pin_t * pin
+);
+
+int cache_pin_retry (
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             adr,
+  _In    u_word_t             len,
+  _Out   struct cache_pin_t * pin
+);
+
+void cache_pin_dirty (
+  _InOut struct cache_t *           cache,
+  _In    const struct cache_pin_t * pin,
+  _In    u_word_t                   dati,
+  _In    u_word_t                   len
+);
+
+void cache_unpin (
+  _InOut struct cache_t *           cache,
+  _In    const struct cache_pin_t * pin
+);
+
+/*
+ * Way partitioning, in the manner of cache allocation masks: `cache_part`
+ * sets up `rqc` requestors, each allowed every way, and lines already
+ * present are charged to requestor 0. The requestor chosen with
+ * `cache_part_use` stays current until the next call; its misses fill only
+ * the ways in its mask while its hits may land in any way. Masks can change
+ * at any time and lines outside a new mask are left to age out. The
+ * built-in policies pick their victim among `cache_way_permitted` ways; a
+ * custom policy may ignore the mask, in which case the next permitted way
+ * after its victim is taken. At most 64 ways and `CACHE_RQ_MAX`
+ * requestors; not available with skewed indexing or in concurrent mode.
+ */
+
+#   define CACHE_RQ_MAX  255
+#   define CACHE_RQ_NONE 0xFF
+
+struct cache_rq_t {
+  u_long_t wmsk;
+  u_long_t occc; /* lines held     */
+  u_long_t accc; /* reads, writes  */
+  u_long_t misc;
+};
+
+#   define cache_way_permitted(cache, wayi) \
+    (!(cache)->rqc || (cache)->wmsk >> (wayi) & U_LONG(1))
+
+/* `rqc` of zero turns partitioning off */
+
+int cache_part (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqc
+);
+
+int cache_part_mask (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqi,
+  _In    u_long_t         wmsk
+);
+
+int cache_part_use (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         rqi
+);
+
+void cache_part_print (
+  _In    const struct cache_t * cache,
+  _Out   FILE *                 fp
+);
+
 int cache_flush (
   _InOut struct cache_t * cache,
   _InOut u_word_t *       _seti,
   _InOut u_word_t *       _wayi
 );
 
+void cache_cc_sync (
+  _InOut struct cache_t * cache
+);
+
+/*
+ * Set sampling: when `smpz` is non-zero only the sets whose index matches
+ * `smpo` modulo `1 << smpz` are stored and simulated; accesses to the other
+ * sets return CACHE_SKIPPED before touching any header. Stored sets are
+ * numbered 0..smpc-1; `cache_set_logical` maps them back to the set index
+ * seen by the `flush` callback.
+ */
+
+#   define cache_set_sampled(cache, seti) \
+    (((seti) & (cache)->smpm) == (cache)->smpo)
+
+#   define cache_set_stored(cache, seti)  ((seti) >> (cache)->smpz)
+#   define cache_set_logical(cache, seti) \
+    (((seti) << (cache)->smpz) | (cache)->smpo)
+
+struct cache_stat_t {
+  u_long_t accc; /* simulated accesses */
+  u_long_t misc; /* simulated misses   */
+  u_long_t skpc; /* skipped accesses   */
+  double   est_accc;
+  double   est_misc;
+  double   mis_rate;
+  double   mis_rate_lo; /* 95% confidence interval over the sampled sets */
+  double   mis_rate_hi;
+  double   wp_rate;     /* hits on the predicted way */
+  double   wp_prb_rate; /* ways probed per hit       */
+};
+
+void cache_stat (
+  _In    const struct cache_t * cache,
+  _Out   struct cache_stat_t *  stat
+);
+
+void cache_stat_print (
+  _In    const struct cache_t * cache,
+  _Out   FILE *                 fp
+);
+
+/* event trace hook, see evt.h */
+
+#   define CACHE_EVT_RD_HIT    0
+#   define CACHE_EVT_RD_MISS   1
+#   define CACHE_EVT_WR_HIT    2
+#   define CACHE_EVT_WR_MISS   3
+#   define CACHE_EVT_FILL      4
+#   define CACHE_EVT_EVICT     5
+#   define CACHE_EVT_WRITEBACK 6
+#   define CACHE_EVT_TYPEC     7
+
+void cache_evt_put (
+  _InOut struct cache_evt_t * evt,
+  _In    u_word_t             type,
+  _In    u_long_t             adr,
+  _In    u_word_t             seti,
+  _In    u_word_t             wayi,
+  _In    u_long_t             tag
+);
+
+/* `cache_dtor` detaches the tracer, which may then be destroyed on its own */
+
+void cache_evt_detach (
+  _InOut struct cache_evt_t * evt
+);
+
+/* miss classification hook, see c3.h */
+
+void cache_c3_put (
+  _InOut struct cache_c3_t * c3,
+  _In    u_word_t            type,
+  _In    u_long_t            adr,
+  _In    u_word_t            seti
+);
+
+/* `cache_dtor` detaches the classifier, which may then be destroyed alone */
+
+void cache_c3_detach (
+  _InOut struct cache_c3_t * c3
+);
+
+/* built-in flush methods and replacement policies, see `cache_ctor` */
+
+int cache_flush_none (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    const u_byte_t * way_hdr,
+  _In    const u_byte_t * way_dat
+);
+
+int cache_flush_print (
+  _InOut struct cache_t * cache,
+  _In    u_word_t         seti,
+  _In    const u_byte_t * way_hdr,
+  _In    const u_byte_t * way_dat
+);
+
+#   define __CACHE_RP_DECL(name)                \
+int cache_rp_##name##_reset (                   \
+  _InOut struct cache_t * cache,                \
+  _In    const u_byte_t * set_hdr,              \
+  _In    const u_byte_t * set_dat               \
+);                                              \
+int cache_rp_##name##_set (                     \
+  _InOut struct cache_t * cache,                \
+  _In    const u_byte_t * set_hdr,              \
+  _In    const u_byte_t * set_dat,              \
+  _In    u_word_t         wayi                  \
+);                                              \
+int cache_rp_##name##_get (                     \
+  _InOut struct cache_t * cache,                \
+  _In    const u_byte_t * set_hdr,              \
+  _In    const u_byte_t * set_dat,              \
+  _Out   u_word_t *       wayi                  \
+);
+
+__CACHE_RP_DECL(lru)
+__CACHE_RP_DECL(plru)
+__CACHE_RP_DECL(random)
+
 struct cache_test_t {
   struct cache_t * cache;
   u_word_t         sr;
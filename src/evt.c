@@ -0,0 +1,313 @@
+# include "evt.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+
+static int _cache_evt_write (
+  _In    int          fd,
+  _In    const void * buf,
+  _In    size_t       len
+)
+{
+  const u_byte_t * ptr = (const u_byte_t *)buf;
+
+  while (len) {
+    ssize_t res = write(fd, ptr, len);
+
+    if (res < 0 && EINTR == errno)
+      continue;
+
+    if (res <= 0)
+      return CACHE_FAILURE;
+
+    ptr += res;
+    len -= (size_t)res;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+static void * _cache_evt_spill (
+  _In    void * arg
+)
+{
+  struct cache_evt_t * evt = (struct cache_evt_t *)arg;
+
+  pthread_mutex_lock(&evt->mtx);
+
+  for (;;) {
+    u_long_t head = __atomic_load_n(&evt->head, __ATOMIC_ACQUIRE);
+    u_long_t tail = evt->tail;
+
+    if (head == tail) {
+      if (evt->stop)
+        break;
+
+      pthread_cond_wait(&evt->cnd_dat, &evt->mtx);
+      continue;
+    }
+
+    pthread_mutex_unlock(&evt->mtx);
+
+    /* the records in [ tail, head ) are ours until `tail` moves */
+
+    while (tail != head) {
+      u_word_t reci = (u_word_t)tail & (evt->recc - U_WORD(1));
+      u_long_t recn = evt->recc - reci;
+
+      if (head - tail < recn) {
+        recn = head - tail;
+      }
+
+      if (!evt->err) {
+        evt->err = _cache_evt_write(
+          evt->fd, evt->recv + reci, recn * sizeof(struct cache_evt_rec_t)
+        );
+      }
+
+      tail += recn;
+    }
+
+    pthread_mutex_lock(&evt->mtx);
+    __atomic_store_n(&evt->tail, tail, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&evt->cnd_spc);
+  }
+
+  pthread_mutex_unlock(&evt->mtx);
+
+  return NULL;
+}
+
+struct cache_evt_t * cache_evt_ctor (
+  _InOut struct cache_evt_t * evt,
+  _InOut struct cache_t *     cache,
+  _In    const char *         path,
+  _In    u_word_t             recc
+)
+{
+  if (!cache || cache->evt || cache_get_cc(cache))
+    return NULL;
+
+  if (recc < U_WORD(2) || recc & (recc - U_WORD(1)))
+    return NULL;
+
+  if (!evt) {
+    evt = (struct cache_evt_t *)malloc(sizeof(struct cache_evt_t));
+
+    if (!evt)
+      return evt;
+
+    evt->sr = 0;
+    cache_evt_set_ho(evt);
+  } else {
+    evt->sr = 0;
+  }
+
+  evt->cache  = cache;
+  evt->recc   = recc;
+  evt->head   = U_LONG(0);
+  evt->tail   = U_LONG(0);
+  evt->seq    = U_LONG(0);
+  evt->set_lo = U_WORD(0);
+  evt->set_hi = ~U_WORD(0);
+  evt->typm   = CACHE_EVT_ALL;
+  evt->stop   = 0;
+  evt->err    = CACHE_SUCCESS;
+  evt->recv   = (struct cache_evt_rec_t *)malloc(
+    recc * sizeof(struct cache_evt_rec_t)
+  );
+  evt->fd     = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  struct cache_evt_hdr_t hdr;
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CACHE_EVT_MAGIC, sizeof(CACHE_EVT_MAGIC));
+  hdr.version = CACHE_EVT_VERSION;
+  hdr.recz    = sizeof(struct cache_evt_rec_t);
+  hdr.setc    = cache->setc;
+  hdr.wayc    = cache->wayc;
+  hdr.datc    = cache->datc;
+  hdr.smpz    = cache->smpz;
+
+  if (
+    !evt->recv  ||
+    evt->fd < 0 ||
+    _cache_evt_write(evt->fd, &hdr, sizeof(hdr))
+  ) {
+    if (0 <= evt->fd) {
+      close(evt->fd);
+    }
+
+    free(evt->recv);
+
+    if (cache_evt_get_ho(evt)) {
+      free(evt);
+    }
+
+    return NULL;
+  }
+
+  pthread_mutex_init(&evt->mtx, NULL);
+  pthread_cond_init(&evt->cnd_dat, NULL);
+  pthread_cond_init(&evt->cnd_spc, NULL);
+
+  if (pthread_create(&evt->thr, NULL, _cache_evt_spill, evt)) {
+    pthread_cond_destroy(&evt->cnd_spc);
+    pthread_cond_destroy(&evt->cnd_dat);
+    pthread_mutex_destroy(&evt->mtx);
+    close(evt->fd);
+    free(evt->recv);
+
+    if (cache_evt_get_ho(evt)) {
+      free(evt);
+    }
+
+    return NULL;
+  }
+
+  cache->evt = evt;
+
+  return evt;
+}
+
+struct cache_evt_t * cache_evt_dtor (
+  _InOut struct cache_evt_t * evt
+)
+{
+  if (!evt)
+    return evt;
+
+  if (evt->cache && evt->cache->evt == evt) {
+    evt->cache->evt = NULL;
+  }
+
+  pthread_mutex_lock(&evt->mtx);
+  evt->stop = 1;
+  pthread_cond_signal(&evt->cnd_dat);
+  pthread_mutex_unlock(&evt->mtx);
+  pthread_join(evt->thr, NULL);
+
+  pthread_cond_destroy(&evt->cnd_spc);
+  pthread_cond_destroy(&evt->cnd_dat);
+  pthread_mutex_destroy(&evt->mtx);
+  close(evt->fd);
+  free(evt->recv);
+  evt->recv = NULL;
+
+  if (cache_evt_get_ho(evt)) {
+    free(evt);
+    evt = NULL;
+  }
+
+  return evt;
+}
+
+void cache_evt_detach (
+  _InOut struct cache_evt_t * evt
+)
+{
+  evt->cache = NULL;
+}
+
+void cache_evt_filter (
+  _InOut struct cache_evt_t * evt,
+  _In    u_word_t             set_lo,
+  _In    u_word_t             set_hi,
+  _In    u_word_t             typm
+)
+{
+  evt->set_lo = set_lo;
+  evt->set_hi = set_hi;
+  evt->typm   = typm & CACHE_EVT_ALL;
+}
+
+int cache_evt_sync (
+  _InOut struct cache_evt_t * evt
+)
+{
+  u_long_t head = evt->head;
+
+  pthread_mutex_lock(&evt->mtx);
+  pthread_cond_signal(&evt->cnd_dat);
+
+  while (__atomic_load_n(&evt->tail, __ATOMIC_ACQUIRE) != head) {
+    pthread_cond_wait(&evt->cnd_spc, &evt->mtx);
+  }
+
+  pthread_mutex_unlock(&evt->mtx);
+
+  return evt->err;
+}
+
+void cache_evt_put (
+  _InOut struct cache_evt_t * evt,
+  _In    u_word_t             type,
+  _In    u_long_t             adr,
+  _In    u_word_t             seti,
+  _In    u_word_t             wayi,
+  _In    u_long_t             tag
+)
+{
+  u_long_t seq = evt->seq;
+
+  /* hits, misses and fills end an access */
+
+  if (type < CACHE_EVT_EVICT) {
+    ++evt->seq;
+  }
+
+  if (
+    !(evt->typm & (U_WORD(1) << type)) ||
+    seti < evt->set_lo || evt->set_hi < seti
+  ) {
+    return;
+  }
+
+  u_long_t head = evt->head;
+
+  if (head - __atomic_load_n(&evt->tail, __ATOMIC_ACQUIRE) == evt->recc) {
+    pthread_mutex_lock(&evt->mtx);
+
+    while (head - evt->tail == evt->recc) {
+      pthread_cond_signal(&evt->cnd_dat);
+      pthread_cond_wait(&evt->cnd_spc, &evt->mtx);
+    }
+
+    pthread_mutex_unlock(&evt->mtx);
+  }
+
+  struct cache_evt_rec_t * rec = (
+    evt->recv + ((u_word_t)head & (evt->recc - U_WORD(1)))
+  );
+
+  rec->seq  = seq;
+  rec->adr  = adr;
+  rec->tag  = tag;
+  rec->seti = seti;
+  rec->wayi = (u_half_t)wayi;
+  rec->type = (u_byte_t)type;
+  rec->rsvd = U_BYTE(0);
+
+  __atomic_store_n(&evt->head, head + U_LONG(1), __ATOMIC_RELEASE);
+
+  /* wake the spill thread every half ring */
+
+  if (!((head + U_LONG(1)) & ((evt->recc >> 1) - U_WORD(1)))) {
+    pthread_mutex_lock(&evt->mtx);
+    pthread_cond_signal(&evt->cnd_dat);
+    pthread_mutex_unlock(&evt->mtx);
+  }
+}
+
+const char * cache_evt_name (
+  _In    u_word_t type
+)
+{
+  static const char * namev[CACHE_EVT_TYPEC] = {
+    "RD_HIT", "RD_MISS", "WR_HIT", "WR_MISS", "FILL", "EVICT", "WRITEBACK"
+  };
+
+  return type < CACHE_EVT_TYPEC ? namev[type] : "UNKNOWN";
+}
@@ -0,0 +1,97 @@
+# ifndef __EVT_H
+#   define __EVT_H
+
+#   include "cache.h"
+#   include <pthread.h>
+
+/*
+ * Binary event trace. Once attached to a cache the recorder appends one
+ * fixed-size record per hit, miss, fill, eviction and writeback to a ring
+ * buffer, which a background thread spills to a file. The file starts with
+ * a `struct cache_evt_hdr_t` and is decoded by `hw-cache-evtdump`.
+ *
+ * Events carry the logical set and the sequence number of the access that
+ * caused them; a full ring stalls the cache until the spill catches up, so
+ * no event is lost. Concurrent mode is not supported. The recorder may
+ * outlive its cache: `cache_dtor` detaches it and only `cache_evt_sync`
+ * and `cache_evt_dtor` are left to call.
+ */
+
+#   define CACHE_EVT_MAGIC   "HWCEVT"
+#   define CACHE_EVT_VERSION 1
+
+struct cache_evt_hdr_t {
+  char     magic[8];
+  u_word_t version;
+  u_word_t recz;  /* in bytes */
+  u_word_t setc;
+  u_word_t wayc;
+  u_word_t datc;
+  u_word_t smpz;
+};
+
+struct cache_evt_rec_t {
+  u_long_t seq;
+  u_long_t adr;
+  u_long_t tag;  /* of the victim for evictions and writebacks */
+  u_word_t seti;
+  u_half_t wayi; /* `wayc` when no way is involved */
+  u_byte_t type;
+  u_byte_t rsvd;
+};
+
+struct cache_evt_t {
+  u_word_t                 sr;
+  int                      fd;
+  struct cache_t *         cache;
+  struct cache_evt_rec_t * recv;
+  u_word_t                 recc; /* power of two */
+  u_long_t                 head;
+  u_long_t                 tail;
+  u_long_t                 seq;
+  u_word_t                 set_lo;
+  u_word_t                 set_hi;
+  u_word_t                 typm;
+  int                      stop;
+  int                      err;
+  pthread_t                thr;
+  pthread_mutex_t          mtx;
+  pthread_cond_t           cnd_dat;
+  pthread_cond_t           cnd_spc;
+};
+
+#   define cache_evt_clr_ho(evt) (evt)->sr &= ~0x1
+#   define cache_evt_set_ho(evt) (evt)->sr |= 0x1
+#   define cache_evt_get_ho(evt) ((evt)->sr & 0x1)
+
+#   define CACHE_EVT_ALL ((U_WORD(1) << CACHE_EVT_TYPEC) - U_WORD(1))
+
+struct cache_evt_t * cache_evt_ctor (
+  _InOut struct cache_evt_t * evt,
+  _InOut struct cache_t *     cache,
+  _In    const char *         path,
+  _In    u_word_t             recc
+);
+
+struct cache_evt_t * cache_evt_dtor (
+  _InOut struct cache_evt_t * evt
+);
+
+/* record only the events in `typm` on logical sets `set_lo` to `set_hi` */
+
+void cache_evt_filter (
+  _InOut struct cache_evt_t * evt,
+  _In    u_word_t             set_lo,
+  _In    u_word_t             set_hi,
+  _In    u_word_t             typm
+);
+
+int cache_evt_sync (
+  _InOut struct cache_evt_t * evt
+);
+
+const char * cache_evt_name (
+  _In    u_word_t type
+);
+
+# endif
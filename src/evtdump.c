@@ -0,0 +1,160 @@
+# include "evt.h"
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+/*
+ * Decoder for the binary event traces written by `cache_evt_ctor`: prints
+ * one line per record, optionally filtered by set and event type, followed
+ * by the count of every event type.
+ */
+
+static void _evtdump_help (
+  _Out   FILE * fp
+)
+{
+  fprintf(
+    fp,
+    "usage: hw-cache-evtdump [options] TRACE\n"
+    "\n"
+    "options:\n"
+    "  -h, --help              --- Print this message.\n"
+    "  -s, --set    LO[:HI]    --- Print only the events of these sets.\n"
+    "  -e, --event  TYPE       --- Print only this event type (repeatable).\n"
+    "  -c, --count             --- Print only the event counts.\n"
+    "\n"
+    "types: RD_HIT, RD_MISS, WR_HIT, WR_MISS, FILL, EVICT, WRITEBACK\n"
+  );
+}
+
+int main (int argc, char ** argv)
+{
+  const char * path   = NULL;
+  u_word_t     set_lo = U_WORD(0);
+  u_word_t     set_hi = ~U_WORD(0);
+  u_word_t     typm   = U_WORD(0);
+  int          cnto   = 0;
+  int          argi;
+
+  for (argi = 1; argi < argc; ++argi) {
+    char * args = argv[argi];
+
+    if (0 == strcmp(args, "-h") || 0 == strcmp(args, "--help")) {
+      _evtdump_help(stdout);
+      return EXIT_SUCCESS;
+    } else if (0 == strcmp(args, "-c") || 0 == strcmp(args, "--count")) {
+      cnto = 1;
+    } else if (argi + 1 == argc) {
+      path = args;
+    } else if (0 == strcmp(args, "-s") || 0 == strcmp(args, "--set")) {
+      int res = sscanf(
+        argv[++argi], "%" SCNu32 ":%" SCNu32, &set_lo, &set_hi
+      );
+
+      if (res < 1)
+        break;
+
+      if (res < 2) {
+        set_hi = set_lo;
+      }
+    } else if (0 == strcmp(args, "-e") || 0 == strcmp(args, "--event")) {
+      u_word_t type;
+
+      for (type = U_WORD(0); type < CACHE_EVT_TYPEC; ++type) {
+        if (0 == strcmp(argv[argi + 1], cache_evt_name(type)))
+          break;
+      }
+
+      if (CACHE_EVT_TYPEC == type)
+        break;
+
+      typm |= U_WORD(1) << type;
+      ++argi;
+    } else {
+      break;
+    }
+  }
+
+  if (argi < argc || !path) {
+    _evtdump_help(stderr);
+    return EXIT_FAILURE;
+  }
+
+  if (!typm) {
+    typm = CACHE_EVT_ALL;
+  }
+
+  FILE * fp = 0 == strcmp(path, "-") ? stdin : fopen(path, "rb");
+
+  if (!fp) {
+    fprintf(stderr, "hw-cache-evtdump: cannot open `%s`\n", path);
+    return EXIT_FAILURE;
+  }
+
+  struct cache_evt_hdr_t hdr;
+  struct cache_evt_rec_t rec;
+
+  if (
+    1 != fread(&hdr, sizeof(hdr), 1, fp)                        ||
+    memcmp(hdr.magic, CACHE_EVT_MAGIC, sizeof(CACHE_EVT_MAGIC)) ||
+    CACHE_EVT_VERSION != hdr.version                            ||
+    sizeof(rec) != hdr.recz
+  ) {
+    fprintf(stderr, "hw-cache-evtdump: `%s` is not an event trace\n", path);
+
+    if (stdin != fp)
+      fclose(fp);
+
+    return EXIT_FAILURE;
+  }
+
+  u_long_t cntv[CACHE_EVT_TYPEC] = { 0 };
+  u_word_t type;
+
+  fprintf(
+    stdout,
+    "EVENTS (%" U_WORD_FMTD " SETS, %" U_WORD_FMTD " WAYS, %" U_WORD_FMTD
+    " BYTE LINES)\n",
+    hdr.setc, hdr.wayc, hdr.datc
+  );
+
+  while (1 == fread(&rec, sizeof(rec), 1, fp)) {
+    if (
+      CACHE_EVT_TYPEC <= rec.type            ||
+      !(typm & (U_WORD(1) << rec.type))      ||
+      rec.seti < set_lo || set_hi < rec.seti
+    ) {
+      continue;
+    }
+
+    ++cntv[rec.type];
+
+    if (cnto)
+      continue;
+
+    fprintf(
+      stdout,
+      "%12" U_LONG_FMTD " %-9s 0x%016" U_LONG_FMTX " %8" U_WORD_FMTD,
+      rec.seq, cache_evt_name(rec.type), rec.adr, rec.seti
+    );
+
+    if (rec.wayi < hdr.wayc) {
+      fprintf(stdout, " %4" U_HALF_FMTD, rec.wayi);
+    } else {
+      fprintf(stdout, " %4s", "-");
+    }
+
+    fprintf(stdout, " 0x%" U_LONG_FMTX "\n", rec.tag);
+  }
+
+  if (stdin != fp)
+    fclose(fp);
+
+  for (type = U_WORD(0); type < CACHE_EVT_TYPEC; ++type) {
+    fprintf(
+      stdout, "| %-9s %12" U_LONG_FMTD "\n", cache_evt_name(type), cntv[type]
+    );
+  }
+
+  return EXIT_SUCCESS;
+}
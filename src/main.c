@@ -1,8 +1,15 @@
 # include "cache.h"
+# include "blk.h"
+# include "sdist.h"
+# include "tlb.h"
+# include "c3.h"
+# include "prof.h"
+# include <fcntl.h>
 # include <stdio.h>
 # include <string.h>
 # include <stdlib.h>
 # include <time.h>
+# include <pthread.h>
 
 int my_flush (
   struct cache_t * cache,
@@ -31,11 +38,120 @@ int my_rp_get (
   u_word_t *       wayi
 );
 
+int test_check (
+  FILE *       fp,
+  const char * what,
+  int          ok
+);
+
+u_byte_t * test_way_hdr (
+  struct cache_t * cache,
+  u_long_t         adr,
+  u_word_t         len
+);
+
+int test_sectors (
+  FILE * fp
+);
+
+int test_pins (
+  FILE * fp
+);
+
+int test_partitions (
+  FILE * fp
+);
+
+int test_access (
+  struct cache_t * cache,
+  u_long_t *       seed
+);
+
+int test_checkpoint (
+  FILE * fp
+);
+
+# define TEST_CC_THRC 4
+
+struct test_cc_t {
+  struct cache_t * cache;
+  u_word_t         thri;
+  u_long_t         hitc;
+  u_long_t         sum;
+};
+
+void * test_cc_run (
+  void * arg
+);
+
+int test_concurrent (
+  FILE * fp
+);
+
+int test_blk (
+  FILE * fp
+);
+
+u_long_t test_stride (
+  char ** argv,
+  int     argc
+);
+
+int test_index (
+  FILE * fp
+);
+
+int test_sdist (
+  FILE * fp
+);
+
+int test_tlb_walk (
+  struct cache_tlb_t *     tlb,
+  u_long_t                 va,
+  struct cache_tlb_ent_t * ent
+);
+
+int test_tlb (
+  FILE * fp
+);
+
+int test_c3 (
+  FILE * fp
+);
+
+int test_same (
+  struct cache_t * cache,
+  struct cache_t * ref,
+  u_word_t         accc
+);
+
+int test_wp (
+  FILE * fp
+);
+
+int test_pt (
+  FILE * fp
+);
+
+int test_probe (
+  FILE * fp
+);
+
+int test_packed (
+  FILE * fp
+);
+
+int test_prof (
+  FILE * fp
+);
+
 int main (int argc, char ** argv)
 {
   srand(time(NULL));
 
-  struct cache_t cache;
+  struct cache_t cache = { 0 };
+
+  int err = 1; /* until the built-in test has passed */
 
   u_word_t hdrz = U_WORD(0);
   u_word_t adrz = U_WORD(48);
@@ -66,7 +182,7 @@ int main (int argc, char ** argv)
     struct cache_test_t * test;
    
     if (test = cache_test_ctor(NULL, &cache)) {
-      cache_test_run(test, stdout);
+      err = CACHE_TEST_PASSED != cache_test_run(test, stdout);
       cache_flush(&cache, NULL, NULL); /* print cache */
       cache_flush(&cache, NULL, NULL); /* print nothing */
       test = cache_test_dtor(test);
@@ -75,7 +191,177 @@ int main (int argc, char ** argv)
     cache_dtor(&cache);
   }
 
-  return 0;
+  err |= CACHE_TEST_PASSED != test_sectors(stdout);
+  err |= CACHE_TEST_PASSED != test_pins(stdout);
+  err |= CACHE_TEST_PASSED != test_partitions(stdout);
+  err |= CACHE_TEST_PASSED != test_checkpoint(stdout);
+  err |= CACHE_TEST_PASSED != test_concurrent(stdout);
+  err |= CACHE_TEST_PASSED != test_blk(stdout);
+  err |= CACHE_TEST_PASSED != test_index(stdout);
+  err |= CACHE_TEST_PASSED != test_sdist(stdout);
+  err |= CACHE_TEST_PASSED != test_tlb(stdout);
+  err |= CACHE_TEST_PASSED != test_c3(stdout);
+  err |= CACHE_TEST_PASSED != test_wp(stdout);
+  err |= CACHE_TEST_PASSED != test_pt(stdout);
+  err |= CACHE_TEST_PASSED != test_probe(stdout);
+  err |= CACHE_TEST_PASSED != test_packed(stdout);
+  err |= CACHE_TEST_PASSED != test_prof(stdout);
+
+  return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int test_check (
+  FILE *       fp,
+  const char * what,
+  int          ok
+)
+{
+  fprintf(fp, "| %-40s %s\n", what, ok ? "OK" : "FAILED");
+
+  return !ok;
+}
+
+/* header of the line holding `adr`, found through a pin */
+
+u_byte_t * test_way_hdr (
+  struct cache_t * cache,
+  u_long_t         adr,
+  u_word_t         len
+)
+{
+  struct cache_pin_t pin;
+
+  if (cache_pin(cache, adr, len, &pin))
+    return NULL;
+
+  cache_unpin(cache, &pin);
+
+  return cache->hdr_buf + pin.seti * cache->hdr_len + pin.wayi * cache->hdrc;
+}
+
+int test_sectors (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:2:2:6", "--policy", "lru", "--flush", "none"
+  };
+
+  struct cache_t cache = { 0 };
+
+  cache.secc = 4; /* 16-byte sectors */
+
+  if (!cache_ctor(&cache, 6, argv))
+    return CACHE_TEST_FAILED;
+
+  cache_reset(&cache, NULL);
+
+  fprintf(fp, "TEST SECTORS\n");
+  fprintf(fp, ".-----------\n");
+
+  u_long_t   adr = U_LONG(0x1000);
+  u_byte_t   wr_buf [64];
+  u_byte_t   rd_buf [64];
+  u_byte_t * way_hdr;
+  int        err = 0;
+
+  memset(wr_buf, 0xAB, sizeof(wr_buf));
+  memset(rd_buf, 0x00, sizeof(rd_buf));
+
+  /* a whole sector written to a missing line is the only valid one */
+
+  err |= test_check(fp, "WRITE SECTOR 1",
+    CACHE_SUCCESS == cache_write(&cache, adr + 16, 16, wr_buf)
+  );
+
+  way_hdr = test_way_hdr(&cache, adr + 16, 16);
+
+  err |= test_check(fp, "SECTOR 1 VALID AND DIRTY", way_hdr &&
+    0x2 == cache_way_sec_valid(&cache, way_hdr)[0] &&
+    0x2 == cache_way_sec_dirty(&cache, way_hdr)[0]
+  );
+
+  err |= test_check(fp, "READ SECTOR 1 HITS",
+    CACHE_SUCCESS == cache_read(&cache, adr + 20, 8, rd_buf) &&
+    0 == memcmp(rd_buf, wr_buf, 8)
+  );
+
+  err |= test_check(fp, "READ SECTOR 0 MISSES",
+    CACHE_FAILURE == cache_read(&cache, adr, 16, rd_buf)
+  );
+
+  err |= test_check(fp, "READ SECTORS 1-2 MISS",
+    CACHE_FAILURE == cache_read(&cache, adr + 16, 32, rd_buf)
+  );
+
+  /* a partial write dirties a sector without validating it */
+
+  err |= test_check(fp, "WRITE HALF SECTOR 2",
+    CACHE_SUCCESS == cache_write(&cache, adr + 32, 8, wr_buf)
+  );
+
+  err |= test_check(fp, "SECTOR 2 DIRTY, NOT VALID", way_hdr &&
+    0x2 == cache_way_sec_valid(&cache, way_hdr)[0] &&
+    0x6 == cache_way_sec_dirty(&cache, way_hdr)[0]
+  );
+
+  err |= test_check(fp, "ONLY WRITTEN BYTES DIRTY", way_hdr &&
+    0x00 == cache_way_dat_dirty(&cache, way_hdr)[1] &&
+    0xFF == cache_way_dat_dirty(&cache, way_hdr)[4] &&
+    0x00 == cache_way_dat_dirty(&cache, way_hdr)[5]
+  );
+
+  err |= test_check(fp, "READ WRITTEN HALF MISSES",
+    CACHE_FAILURE == cache_read(&cache, adr + 32, 8, rd_buf)
+  );
+
+  /* a fill completes every sector around the written bytes */
+
+  memset(wr_buf, 0x11, sizeof(wr_buf));
+
+  err |= test_check(fp, "FILL LINE",
+    CACHE_SUCCESS == cache_fill(&cache, adr, wr_buf)
+  );
+
+  err |= test_check(fp, "ALL SECTORS VALID", way_hdr &&
+    0xF == cache_way_sec_valid(&cache, way_hdr)[0] &&
+    0x6 == cache_way_sec_dirty(&cache, way_hdr)[0]
+  );
+
+  err |= test_check(fp, "READ LINE MERGES WRITES AND FILL",
+    CACHE_SUCCESS == cache_read(&cache, adr, 64, rd_buf) &&
+    0x11 == rd_buf[0]  && 0xAB == rd_buf[16] &&
+    0xAB == rd_buf[39] && 0x11 == rd_buf[40]
+  );
+
+  cache_dtor(&cache);
+
+  /* without sectors a partial write miss is left to the next level */
+
+  struct cache_t * line = cache_ctor(NULL, 6, argv);
+
+  if (line) {
+    cache_reset(line, NULL);
+
+    err |= test_check(fp, "UNSECTORED PARTIAL WRITE MISSES",
+      CACHE_FAILURE == cache_write(line, adr + 16, 16, wr_buf) &&
+      CACHE_FAILURE == cache_read(line, adr + 16, 16, rd_buf) &&
+      U_LONG(1) == line->wr_misc
+    );
+
+    err |= test_check(fp, "UNSECTORED WHOLE WRITE ALLOCATES",
+      CACHE_SUCCESS == cache_write(line, adr, 64, wr_buf) &&
+      CACHE_SUCCESS == cache_read(line, adr + 16, 16, rd_buf)
+    );
+
+    line = cache_dtor(line);
+  } else {
+    err = 1;
+  }
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
 }
 
 int my_flush (
@@ -191,3 +477,1363 @@ int my_rp_get (
 
   return -1;
 }
+
+int test_pins (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:2:4:6", "--policy", "lru", "--flush", "none"
+  };
+
+  struct cache_t * cache = cache_ctor(NULL, 6, argv);
+
+  if (!cache)
+    return CACHE_TEST_FAILED;
+
+  cache_reset(cache, NULL);
+
+  fprintf(fp, "TEST PINS\n");
+  fprintf(fp, ".--------\n");
+
+  struct cache_pin_t pinv [4];
+  u_byte_t           buf [64];
+  u_word_t           wayi;
+  int                err = 0;
+
+  /* lines 256 bytes apart share set 0 */
+
+  for (wayi = U_WORD(0); wayi < 4; ++wayi) {
+    memset(buf, (int)wayi + 1, sizeof(buf));
+
+    err |= test_check(fp, "FILL AND PIN",
+      CACHE_SUCCESS == cache_fill(cache, wayi * U_LONG(256), buf) &&
+      CACHE_SUCCESS == cache_pin(cache, wayi * U_LONG(256), 64, &pinv[wayi])
+    );
+  }
+
+  err |= test_check(fp, "FOUR PINS OUTSTANDING", U_LONG(4) == cache->pinc);
+
+  /* every way of the set is pinned: misses wait */
+
+  err |= test_check(fp, "FILL WAITS",
+    CACHE_WAITING == cache_fill(cache, U_LONG(4) * 256, buf)
+  );
+
+  err |= test_check(fp, "WRITE MISS WAITS",
+    CACHE_WAITING == cache_write(cache, U_LONG(5) * 256, 64, buf)
+  );
+
+  err |= test_check(fp, "OTHER SETS UNAFFECTED",
+    CACHE_SUCCESS == cache_fill(cache, U_LONG(64), buf)
+  );
+
+  /* a released line is the only one that can go */
+
+  pinv[2].dat[3] = 0x77;
+  cache_pin_dirty(cache, &pinv[2], 3, 1);
+  cache_unpin(cache, &pinv[2]);
+
+  err |= test_check(fp, "FILL AFTER UNPIN",
+    CACHE_SUCCESS == cache_fill(cache, U_LONG(4) * 256, buf)
+  );
+
+  err |= test_check(fp, "UNPINNED LINE EVICTED",
+    CACHE_FAILURE == cache_read(cache, U_LONG(2) * 256, 8, buf)
+  );
+
+  for (wayi = U_WORD(0); wayi < 4; ++wayi) {
+    if (2 == wayi)
+      continue;
+
+    err |= test_check(fp, "PINNED LINE KEPT",
+      CACHE_SUCCESS == cache_read(cache, wayi * U_LONG(256), 8, buf) &&
+      (u_byte_t)(wayi + 1) == buf[0]
+    );
+
+    cache_unpin(cache, &pinv[wayi]);
+  }
+
+  err |= test_check(fp, "NO PINS OUTSTANDING", U_LONG(0) == cache->pinc);
+
+  err |= test_check(fp, "FILL AFTER ALL UNPINNED",
+    CACHE_SUCCESS == cache_fill(cache, U_LONG(5) * 256, buf)
+  );
+
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+int test_partitions (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:2:8:6", "--policy", "lru", "--flush", "none"
+  };
+
+  struct cache_t * cache = cache_ctor(NULL, 6, argv);
+
+  if (!cache)
+    return CACHE_TEST_FAILED;
+
+  cache_reset(cache, NULL);
+
+  fprintf(fp, "TEST PARTITIONS\n");
+  fprintf(fp, ".--------------\n");
+
+  struct cache_pin_t pin;
+  u_byte_t           buf [64];
+  u_long_t           adr;
+  u_word_t           lini;
+  int                err = 0;
+
+  memset(buf, 0, sizeof(buf));
+
+  err |= test_check(fp, "TWO REQUESTORS",
+    CACHE_SUCCESS == cache_part(cache, 2)            &&
+    CACHE_SUCCESS == cache_part_mask(cache, 0, 0x0F) &&
+    CACHE_SUCCESS == cache_part_mask(cache, 1, 0xF0)
+  );
+
+  err |= test_check(fp, "BAD MASK AND REQUESTOR REJECTED",
+    CACHE_FAILURE == cache_part_mask(cache, 1, 0x100) &&
+    CACHE_FAILURE == cache_part_mask(cache, 2, 0x0F)  &&
+    CACHE_FAILURE == cache_part_use(cache, 2)
+  );
+
+  /* requestor 0 loads four lines of set 0, requestor 1 streams through it */
+
+  cache_part_use(cache, 0);
+
+  for (lini = U_WORD(0); lini < 4; ++lini) {
+    adr = lini * U_LONG(256);
+
+    if (cache_read(cache, adr, 8, buf)) {
+      cache_fill(cache, adr, buf);
+    }
+  }
+
+  cache_part_use(cache, 1);
+
+  for (lini = U_WORD(0); lini < 32; ++lini) {
+    adr = (lini + 100) * U_LONG(256);
+
+    if (cache_read(cache, adr, 8, buf)) {
+      cache_fill(cache, adr, buf);
+    }
+  }
+
+  cache_part_use(cache, 0);
+
+  for (lini = U_WORD(0); lini < 4; ++lini) {
+    err |= test_check(fp, "REQUESTOR 0 LINE KEPT",
+      CACHE_SUCCESS == cache_read(cache, lini * U_LONG(256), 8, buf)
+    );
+  }
+
+  err |= test_check(fp, "REQUESTOR 0 ACCOUNTED",
+    U_LONG(4) == cache->rq_buf[0].occc &&
+    U_LONG(8) == cache->rq_buf[0].accc &&
+    U_LONG(4) == cache->rq_buf[0].misc
+  );
+
+  err |= test_check(fp, "REQUESTOR 1 ACCOUNTED",
+    U_LONG(4)  == cache->rq_buf[1].occc &&
+    U_LONG(32) == cache->rq_buf[1].accc &&
+    U_LONG(32) == cache->rq_buf[1].misc
+  );
+
+  /* the last four lines streamed sit in the ways of requestor 1 */
+
+  cache_part_use(cache, 1);
+
+  for (lini = U_WORD(128); lini < 132; ++lini) {
+    int res = cache_pin(cache, lini * U_LONG(256), 8, &pin);
+
+    err |= test_check(fp, "REQUESTOR 1 LINE IN ITS WAYS",
+      CACHE_SUCCESS == res && 4 <= pin.wayi
+    );
+
+    if (CACHE_SUCCESS == res) {
+      cache_unpin(cache, &pin);
+    }
+  }
+
+  err |= test_check(fp, "PARTITIONING OFF",
+    CACHE_SUCCESS == cache_part(cache, 0) && !cache->rqc
+  );
+
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* one access of a fixed pseudo-random stream, filling on a read miss */
+
+int test_access (
+  struct cache_t * cache,
+  u_long_t *       seed
+)
+{
+  u_byte_t buf [64];
+  int      res;
+
+  *seed = *seed * U_LONG(6364136223846793005) + U_LONG(1442695040888963407);
+
+  u_long_t adr = (*seed >> 33) % U_LONG(4096) * 64;
+
+  memset(buf, (int)(*seed >> 56), sizeof(buf));
+
+  if ((*seed >> 40) % 4 == 0)
+    return cache_write(cache, adr, 8, buf);
+
+  res = cache_read(cache, adr, 8, buf);
+
+  if (CACHE_FAILURE == res) {
+    cache_fill(cache, adr, buf);
+  }
+
+  return res;
+}
+
+int test_checkpoint (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:4:4:6", "--policy", "lru", "--flush", "none"
+  };
+
+  const char * path = "cache_test.ckpt";
+
+  struct cache_t * cache = cache_ctor(NULL, 6, argv);
+  struct cache_t * copy  = NULL;
+
+  if (!cache)
+    return CACHE_TEST_FAILED;
+
+  cache_reset(cache, NULL);
+
+  fprintf(fp, "TEST CHECKPOINT\n");
+  fprintf(fp, ".--------------\n");
+
+  u_long_t seed = U_LONG(1);
+  u_word_t acci;
+  int      err  = 0;
+
+  for (acci = U_WORD(0); acci < 10000; ++acci) {
+    test_access(cache, &seed);
+  }
+
+  err |= test_check(fp, "SAVE",
+    CACHE_SUCCESS == cache_save(cache, path)
+  );
+
+  err |= test_check(fp, "LOAD",
+    NULL != (copy = cache_load(NULL, path))
+  );
+
+  if (copy) {
+    u_long_t seed_copy = seed;
+    u_word_t diffc     = U_WORD(0);
+
+    /* callbacks are not saved */
+
+    copy->flush    = cache->flush;
+    copy->rp_reset = cache->rp_reset;
+    copy->rp_set   = cache->rp_set;
+    copy->rp_get   = cache->rp_get;
+
+    u_long_t rd_hitc = cache->rd_hitc;
+    u_long_t wr_hitc = cache->wr_hitc;
+
+    for (acci = U_WORD(0); acci < 10000; ++acci) {
+      diffc += test_access(cache, &seed) != test_access(copy, &seed_copy);
+    }
+
+    err |= test_check(fp, "SAME HITS AND MISSES", !diffc &&
+      cache->rd_hitc - rd_hitc == copy->rd_hitc &&
+      cache->wr_hitc - wr_hitc == copy->wr_hitc &&
+      copy->rd_hitc
+    );
+
+    copy = cache_dtor(copy);
+  }
+
+  remove(path);
+
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* thread `thri` only touches the sets equal to `thri` modulo the threads */
+
+void * test_cc_run (
+  void * arg
+)
+{
+  struct test_cc_t * run = (struct test_cc_t *)arg;
+
+  u_byte_t buf [64];
+  u_long_t seed = run->thri + U_LONG(1);
+  u_word_t acci;
+
+  for (acci = U_WORD(0); acci < 20000; ++acci) {
+    seed = seed * U_LONG(6364136223846793005) + U_LONG(1442695040888963407);
+
+    u_long_t adr = (
+      (seed >> 33) % U_LONG(256) * TEST_CC_THRC + run->thri
+    ) * 64;
+
+    if ((seed >> 40) % 4 == 0) {
+      memset(buf, (int)(seed >> 56), sizeof(buf));
+      cache_write(run->cache, adr, 64, buf);
+      continue;
+    }
+
+    if (CACHE_SUCCESS == cache_read(run->cache, adr, 64, buf)) {
+      ++run->hitc;
+      run->sum += buf[0] + buf[63];
+    } else {
+      memset(buf, (int)(adr >> 6), sizeof(buf));
+      cache_fill(run->cache, adr, buf);
+    }
+  }
+
+  return NULL;
+}
+
+int test_concurrent (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:4:4:6", "--policy", "lru", "--flush", "none"
+  };
+
+  struct cache_t   cc   = { 0 };
+  struct cache_t * ref  = cache_ctor(NULL, 6, argv);
+  struct test_cc_t runv [TEST_CC_THRC];
+  struct test_cc_t refv [TEST_CC_THRC];
+  pthread_t        thrv [TEST_CC_THRC];
+  u_word_t         thrc;
+  u_word_t         thri;
+  int              err  = 0;
+
+  /* every read hit updates the policy, as without concurrent mode */
+
+  cache_set_cc(&cc);
+  cc.ccs = U_WORD(0);
+
+  if (!ref || !cache_ctor(&cc, 6, argv)) {
+    cache_dtor(ref);
+    return CACHE_TEST_FAILED;
+  }
+
+  cache_reset(ref, NULL);
+  cache_reset(&cc, NULL);
+
+  fprintf(fp, "TEST CONCURRENT\n");
+  fprintf(fp, ".---------------\n");
+
+  for (thri = U_WORD(0); thri < TEST_CC_THRC; ++thri) {
+    memset(refv + thri, 0, sizeof(refv[thri]));
+    refv[thri].cache = ref;
+    refv[thri].thri  = thri;
+    test_cc_run(refv + thri);
+
+    memset(runv + thri, 0, sizeof(runv[thri]));
+    runv[thri].cache = &cc;
+    runv[thri].thri  = thri;
+  }
+
+  for (thrc = U_WORD(0); thrc < TEST_CC_THRC; ++thrc) {
+    if (pthread_create(thrv + thrc, NULL, test_cc_run, runv + thrc))
+      break;
+  }
+
+  int samec = 0;
+
+  for (thri = U_WORD(0); thri < thrc; ++thri) {
+    pthread_join(thrv[thri], NULL);
+
+    samec += (
+      runv[thri].hitc == refv[thri].hitc &&
+      runv[thri].sum  == refv[thri].sum
+    );
+  }
+
+  cache_cc_sync(&cc);
+
+  err |= test_check(fp, "THREADS STARTED", TEST_CC_THRC == thrc);
+  err |= test_check(fp, "SAME HITS AND DATA PER THREAD",
+    TEST_CC_THRC == samec && refv[0].hitc
+  );
+  err |= test_check(fp, "SAME COUNTERS",
+    cc.rd_hitc == ref->rd_hitc && cc.rd_misc == ref->rd_misc &&
+    cc.wr_hitc == ref->wr_hitc && cc.wr_misc == ref->wr_misc
+  );
+
+  cache_dtor(&cc);
+  ref = cache_dtor(ref);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+int test_blk (
+  FILE * fp
+)
+{
+  const char * path = "cache_test.blk";
+
+  u_byte_t file [16 * 64];
+  u_byte_t back [16 * 64];
+  u_byte_t buf  [256];
+  u_word_t byti;
+  FILE *   fil;
+  int      err  = 0;
+
+  for (byti = U_WORD(0); byti < sizeof(file); ++byti) {
+    file[byti] = (u_byte_t)(byti * 7 + 3);
+  }
+
+  if (!(fil = fopen(path, "wb")))
+    return CACHE_TEST_FAILED;
+
+  fwrite(file, 1, sizeof(file), fil);
+  fclose(fil);
+
+  /* 4 sets of 4 ways, lines of 4 sectors */
+
+  struct cache_blk_t blk = { 0 };
+
+  blk.cache.dats     = 0;
+  blk.cache.sets     = 6;
+  blk.cache.tags     = 8;
+  blk.cache.setc     = 4;
+  blk.cache.wayc     = 4;
+  blk.cache.datc     = 64;
+  blk.cache.secc     = 4;
+  blk.cache.tagz     = 32;
+  blk.cache.hdrc     = u_round_up(blk.cache.tagz + 8, 8);
+  blk.cache.rp_reset = cache_rp_lru_reset;
+  blk.cache.rp_set   = cache_rp_lru_set;
+  blk.cache.rp_get   = cache_rp_lru_get;
+
+  if (!cache_blk_ctor(&blk, path, O_RDWR, 4)) {
+    remove(path);
+    return CACHE_TEST_FAILED;
+  }
+
+  fprintf(fp, "TEST BLK\n");
+  fprintf(fp, ".--------\n");
+
+  /* line 0 misses alone, line 1 is sequential and reads 1 to 4 ahead */
+
+  int same = 1;
+
+  for (byti = U_WORD(0); byti < 5 * 64; byti += 64) {
+    same &= !cache_blk_read(&blk, byti, 64, buf);
+    same &= !memcmp(buf, file + byti, 64);
+  }
+
+  err |= test_check(fp, "READ RETURNS THE FILE", same);
+  err |= test_check(fp, "READ-AHEAD", 2 == blk.rd_ioc);
+  err |= test_check(fp, "MISSES COUNTED ONCE",
+    2 == blk.cache.rd_misc && 3 == blk.cache.rd_hitc
+  );
+
+  /* a partial write fetches its line, then patches it */
+
+  memset(buf, 0xA5, 10);
+  memcpy(file + 5 * 64 + 3, buf, 10);
+
+  err |= test_check(fp, "PARTIAL WRITE",
+    !cache_blk_write(&blk, 5 * 64 + 3, 10, buf) && 3 == blk.rd_ioc &&
+    3 == blk.cache.rd_misc && 3 == blk.cache.rd_hitc
+  );
+
+  memset(buf, 0x5A, 64);
+  memcpy(file + 2 * 64, buf, 64);
+
+  err |= test_check(fp, "WHOLE WRITE",
+    !cache_blk_write(&blk, 2 * 64, 64, buf) && 3 == blk.rd_ioc
+  );
+
+  err |= test_check(fp, "SYNC", !cache_blk_sync(&blk));
+
+  memset(back, 0, sizeof(back));
+
+  if ((fil = fopen(path, "rb"))) {
+    fread(back, 1, sizeof(back), fil);
+    fclose(fil);
+  }
+
+  err |= test_check(fp, "FILE HOLDS THE WRITES",
+    !memcmp(back, file, sizeof(file))
+  );
+
+  err |= test_check(fp, "RE-READ ACROSS LINES",
+    !cache_blk_read(&blk, 100, 256, buf) && !memcmp(buf, file + 100, 256)
+  );
+
+  cache_blk_dtor(&blk);
+  remove(path);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* misses of 8 lines a whole cache size apart, read 16 times over */
+
+u_long_t test_stride (
+  char ** argv,
+  int     argc
+)
+{
+  struct cache_t * cache = cache_ctor(NULL, argc, argv);
+  u_long_t         misc  = U_LONG_MAX;
+  u_word_t         acci;
+
+  if (!cache)
+    return misc;
+
+  cache_reset(cache, NULL);
+
+  for (acci = U_WORD(0); acci < 16 * 8; ++acci) {
+    u_long_t adr = (u_long_t)(acci % 8) * 16 * 64;
+
+    if (CACHE_FAILURE == cache_read(cache, adr, 64, NULL)) {
+      cache_fill(cache, adr, NULL);
+    }
+  }
+
+  misc  = cache->rd_misc;
+  cache = cache_dtor(cache);
+
+  return misc;
+}
+
+int test_index (
+  FILE * fp
+)
+{
+  /* 16 sets of 2 ways, or 13 sets with prime indexing */
+
+  char * bits  [] = { "--geom", "32:4:2:6" };
+  char * xor   [] = { "--geom", "32:4:2:6", "--index", "xor" };
+  char * prime [] = { "--geom", "32:4:2:6", "--index", "prime", "--sets", "13" };
+  char * skew  [] = { "--geom", "32:4:2:6", "--index", "skew:2" };
+  char * bad   [] = { "--geom", "32:4:2:6", "--sets", "13" };
+
+  int err = 0;
+
+  fprintf(fp, "TEST INDEX\n");
+  fprintf(fp, ".----------\n");
+
+  u_long_t bits_misc = test_stride(bits, 2);
+
+  err |= test_check(fp, "BITS CONFLICTS", 16 * 8 == bits_misc);
+  err |= test_check(fp, "XOR SPREADS", 8 == test_stride(xor, 4));
+  err |= test_check(fp, "PRIME SPREADS", 8 == test_stride(prime, 6));
+  err |= test_check(fp, "SKEW SPREADS", test_stride(skew, 4) < bits_misc / 4);
+  err |= test_check(fp, "ODD SETS NEED PRIME",
+    U_LONG_MAX == test_stride(bad, 4)
+  );
+
+  /* the quotient of the highest line still fits the tag */
+
+  struct cache_t * cache = cache_ctor(NULL, 6, prime);
+  struct cache_pin_t pin;
+
+  u_long_t adr = U_LONG(0xFFFFFFC0);
+  int      ok  = 0;
+
+  if (cache) {
+    cache_reset(cache, NULL);
+    cache_fill(cache, adr, NULL);
+
+    if (!cache_pin(cache, adr, 64, &pin)) {
+      u_byte_t * way_hdr = cache->hdr_buf + pin.seti * cache->hdr_len +
+        pin.wayi * cache->hdrc;
+
+      ok = 13 == cache->setc &&
+        adr == cache_way_get_adr(cache, pin.seti, pin.wayi, way_hdr);
+      cache_unpin(cache, &pin);
+    }
+
+    cache = cache_dtor(cache);
+  }
+
+  err |= test_check(fp, "PRIME REBUILDS THE ADDRESS", ok);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* against move-to-front LRU stacks, one per set, searched linearly */
+
+int test_sdist (
+  FILE * fp
+)
+{
+  struct cache_sdist_t sd;
+
+  u_long_t trc  [4000];
+  u_long_t stk  [8][64];
+  u_word_t stkc [8];
+  u_long_t misv [4][9];
+  u_long_t seed = U_LONG(7);
+  u_word_t acci, sets, seti, wayc, dist;
+  int      err  = 0;
+
+  if (!cache_sdist_ctor(&sd, 6, 0, 3, 8))
+    return CACHE_TEST_FAILED;
+
+  fprintf(fp, "TEST SDIST\n");
+  fprintf(fp, ".----------\n");
+
+  /* a hot loop of 12 lines over a cold range of 64 */
+
+  for (acci = U_WORD(0); acci < 4000; ++acci) {
+    seed = seed * U_LONG(6364136223846793005) + U_LONG(1442695040888963407);
+
+    u_long_t lin = (seed >> 40) % 4 ? acci % 12 : (seed >> 33) % 64;
+
+    trc[acci] = lin * 64 + (seed >> 58);
+    cache_sdist_access(&sd, trc[acci]);
+  }
+
+  memset(misv, 0, sizeof(misv));
+
+  for (sets = U_WORD(0); sets < 4; ++sets) {
+    memset(stkc, 0, sizeof(stkc));
+
+    for (acci = U_WORD(0); acci < 4000; ++acci) {
+      u_long_t lin = trc[acci] >> 6;
+
+      seti = (u_word_t)lin & ((U_WORD(1) << sets) - U_WORD(1));
+
+      for (dist = U_WORD(0); dist < stkc[seti]; ++dist) {
+        if (lin == stk[seti][dist])
+          break;
+      }
+
+      for (wayc = U_WORD(1); wayc <= 8; ++wayc) {
+        misv[sets][wayc] += wayc <= dist || dist == stkc[seti];
+      }
+
+      if (dist == stkc[seti]) {
+        ++stkc[seti];
+      }
+
+      memmove(stk[seti] + 1, stk[seti], dist * sizeof(u_long_t));
+      stk[seti][0] = lin;
+    }
+  }
+
+  int same = 1;
+
+  for (sets = U_WORD(0); sets < 4; ++sets) {
+    for (wayc = U_WORD(1); wayc <= 8; ++wayc) {
+      same &= misv[sets][wayc] == cache_sdist_misses(&sd, sets, wayc);
+    }
+  }
+
+  err |= test_check(fp, "SAME MISSES AS LRU STACKS", same && misv[3][8]);
+  err |= test_check(fp, "OUT OF RANGE",
+    U_LONG_MAX == cache_sdist_misses(&sd, 4, 1) &&
+    U_LONG_MAX == cache_sdist_misses(&sd, 0, 9)
+  );
+
+  /* and as the cache itself with 4 sets of 4 LRU ways */
+
+  char * argv [] = { "--geom", "32:2:4:6", "--policy", "lru" };
+
+  struct cache_t * cache = cache_ctor(NULL, 4, argv);
+
+  if (cache) {
+    cache_reset(cache, NULL);
+
+    for (acci = U_WORD(0); acci < 4000; ++acci) {
+      if (CACHE_FAILURE == cache_read(cache, trc[acci], 1, NULL)) {
+        cache_fill(cache, trc[acci], NULL);
+      }
+    }
+  }
+
+  err |= test_check(fp, "SAME MISSES AS THE CACHE",
+    cache && cache->rd_misc == cache_sdist_misses(&sd, 2, 4)
+  );
+
+  cache = cache_dtor(cache);
+  cache_sdist_dtor(&sd);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* 4 KiB pages below 4 GiB with bit 30 flipped, read only from 64 KiB */
+
+int test_tlb_walk (
+  struct cache_tlb_t *     tlb,
+  u_long_t                 va,
+  struct cache_tlb_ent_t * ent
+)
+{
+  (void)tlb;
+
+  if (U_LONG(0x100000000) <= va)
+    return CACHE_FAILURE;
+
+  ent->pa   = (va ^ U_LONG(0x40000000)) & ~U_LONG(0xFFF);
+  ent->pgsi = CACHE_TLB_4K;
+  ent->perm = CACHE_TLB_R;
+
+  if (va < U_LONG(0x10000) || U_LONG(0x20000) <= va) {
+    ent->perm |= CACHE_TLB_W;
+  }
+
+  return CACHE_SUCCESS;
+}
+
+int test_tlb (
+  FILE * fp
+)
+{
+  /* 4 sets of 4 ways and 2 huge entries above 16 sets of 8 ways */
+
+  char * argv  [] = {
+    "--va", "39", "--l1", "4k=2:4,2m=0:2", "--l2", "4k=4:8"
+  };
+  char * junk  [] = { "--va", "39x" };
+  char * wide  [] = { "--va", "65" };
+  char * small [] = { "--va", "12" };
+  char * geom  [] = { "--geom", "32:2:4:6", "--policy", "lru" };
+
+  struct cache_tlb_ent_t ent;
+  struct cache_tlb_ent_t out;
+  u_word_t               lvli = U_WORD(0);
+  u_word_t               vpn, pas;
+  int                    err  = 0;
+
+  fprintf(fp, "TEST TLB\n");
+  fprintf(fp, ".--------\n");
+
+  err |= test_check(fp, "REJECTS BAD VA BITS",
+    !cache_tlb_ctor(NULL, 2, junk) &&
+    !cache_tlb_ctor(NULL, 2, wide) &&
+    !cache_tlb_ctor(NULL, 2, small)
+  );
+
+  struct cache_tlb_t * tlb = cache_tlb_ctor(NULL, 6, argv);
+
+  if (!tlb)
+    return CACHE_TEST_FAILED;
+
+  ent.pa   = U_LONG(0x777000);
+  ent.pgsi = CACHE_TLB_4K;
+  ent.perm = CACHE_TLB_R | CACHE_TLB_W;
+
+  int res = cache_tlb_lookup(tlb, U_LONG(0x12345), &out, NULL);
+
+  cache_tlb_fill(tlb, U_LONG(0x12345), &ent);
+
+  err |= test_check(fp, "MISS THEN HIT",
+    CACHE_FAILURE == res &&
+    CACHE_SUCCESS == cache_tlb_lookup(tlb, U_LONG(0x12345), &out, &lvli) &&
+    U_LONG(0x777345) == out.pa && 0 == lvli &&
+    (CACHE_TLB_R | CACHE_TLB_W) == out.perm
+  );
+
+  struct cache_t * arr = tlb->lvlv[0].arrv + CACHE_TLB_4K;
+
+  err |= test_check(fp, "FILLS ARE NOT WRITES",
+    0 == arr->wr_hitc + arr->wr_misc && 1 == arr->rd_hitc
+  );
+
+  ent.pa = U_LONG(0x888000);
+  cache_tlb_fill(tlb, U_LONG(0x12345), &ent);
+
+  err |= test_check(fp, "REMAP REPLACES",
+    CACHE_SUCCESS == cache_tlb_lookup(tlb, U_LONG(0x12345), &out, NULL) &&
+    U_LONG(0x888345) == out.pa
+  );
+
+  ent.pa   = U_LONG(0x80000000);
+  ent.pgsi = CACHE_TLB_2M;
+  cache_tlb_fill(tlb, U_LONG(0x40000000), &ent);
+
+  err |= test_check(fp, "HUGE PAGE",
+    CACHE_SUCCESS == cache_tlb_lookup(tlb, U_LONG(0x40012345), &out, NULL) &&
+    U_LONG(0x80012345) == out.pa && CACHE_TLB_2M == out.pgsi
+  );
+
+  /* 32 pages overflow the first level but not the second */
+
+  cache_tlb_reset(tlb);
+  ent.pgsi = CACHE_TLB_4K;
+
+  for (vpn = U_WORD(0); vpn < 32; ++vpn) {
+    ent.pa = (u_long_t)vpn << 12;
+    cache_tlb_fill(tlb, ent.pa, &ent);
+  }
+
+  err |= test_check(fp, "SECOND LEVEL REFILLS THE FIRST",
+    CACHE_SUCCESS == cache_tlb_lookup(tlb, U_LONG(0), &out, &lvli) &&
+    1 == lvli &&
+    CACHE_SUCCESS == cache_tlb_lookup(tlb, U_LONG(0), &out, &lvli) &&
+    0 == lvli
+  );
+
+  /* one pass over 4 pages, against a cache fed the translated addresses */
+
+  struct cache_t * cache = cache_ctor(NULL, 4, geom);
+  struct cache_t * ref   = cache_ctor(NULL, 4, geom);
+
+  if (cache && ref) {
+    cache_tlb_reset(tlb);
+    cache_reset(cache, NULL);
+    cache_reset(ref, NULL);
+    tlb->walk = test_tlb_walk;
+
+    for (pas = U_WORD(0); pas < 3; ++pas) {
+      for (vpn = U_WORD(0); vpn < 4; ++vpn) {
+        u_long_t va = ((u_long_t)vpn << 12) + U_LONG(0x40);
+        u_long_t pa = va ^ U_LONG(0x40000000);
+
+        cache_tlb_access(tlb, cache, va, 4, CACHE_TLB_R);
+
+        if (CACHE_FAILURE == cache_read(ref, pa, 4, NULL)) {
+          cache_fill(ref, pa, NULL);
+        }
+      }
+    }
+  }
+
+  err |= test_check(fp, "ONE PASS CO-SIMULATION",
+    cache && ref && 0 == tlb->fltc &&
+    4 == tlb->lvlv[0].misc && 8 == tlb->lvlv[0].hitc &&
+    4 == tlb->lvlv[1].misc && 4 == cache->rd_misc &&
+    ref->rd_misc == cache->rd_misc && ref->rd_hitc == cache->rd_hitc
+  );
+
+  err |= test_check(fp, "PAGE FAULTS",
+    cache &&
+    CACHE_FAILURE == cache_tlb_access(
+      tlb, cache, U_LONG(0x100000000), 4, CACHE_TLB_R
+    ) &&
+    CACHE_FAILURE == cache_tlb_access(
+      tlb, cache, U_LONG(0x10000), 4, CACHE_TLB_W
+    ) &&
+    2 == tlb->fltc
+  );
+
+  cache = cache_dtor(cache);
+  ref   = cache_dtor(ref);
+  tlb   = cache_tlb_dtor(tlb);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+int test_c3 (
+  FILE * fp
+)
+{
+  /* 4 sets of 2 LRU ways, 8 lines in all */
+
+  char * argv [] = { "--geom", "32:2:2:6", "--policy", "lru" };
+
+  u_long_t trc [4 + 30 + 32];
+  u_word_t trcc = U_WORD(0);
+  u_word_t lini, pasi;
+  int      err  = 0;
+
+  /* one line per set, compulsory misses */
+
+  for (lini = U_WORD(0); lini < 4; ++lini) {
+    trc[trcc++] = (u_long_t)lini * 64;
+  }
+
+  /* three lines ping-pong through the 2 ways of set 0: conflicts */
+
+  for (pasi = U_WORD(0); pasi < 10; ++pasi) {
+    for (lini = U_WORD(0); lini < 3; ++lini) {
+      trc[trcc++] = (u_long_t)lini * 4 * 64;
+    }
+  }
+
+  /* 16 lines twice round the 8 lines of the cache: capacity misses */
+
+  for (pasi = U_WORD(0); pasi < 2; ++pasi) {
+    for (lini = U_WORD(0); lini < 16; ++lini) {
+      trc[trcc++] = (u_long_t)(100 + lini) * 64;
+    }
+  }
+
+  fprintf(fp, "TEST C3\n");
+  fprintf(fp, ".-------\n");
+
+  struct cache_t *    cache = cache_ctor(NULL, 4, argv);
+  struct cache_c3_t * c3    = cache ? cache_c3_ctor(NULL, cache) : NULL;
+
+  struct cache_c3_cnt_t set0 = { 0 };
+
+  if (c3) {
+    cache_reset(cache, NULL);
+
+    for (lini = U_WORD(0); lini < trcc; ++lini) {
+      if (CACHE_FAILURE == cache_read(cache, trc[lini], 1, NULL)) {
+        cache_fill(cache, trc[lini], NULL);
+      }
+    }
+
+    cache_c3_set(c3, 0, &set0);
+  }
+
+  err |= test_check(fp, "COMPULSORY", c3 && 22 == c3->tot.cmpc);
+  err |= test_check(fp, "CONFLICT", c3 && 27 == c3->tot.cnfc);
+  err |= test_check(fp, "CAPACITY", c3 && 16 == c3->tot.capc);
+  err |= test_check(fp, "MISSES ADD UP",
+    c3 && 66 == c3->tot.accc &&
+    cache->rd_misc == c3->tot.cmpc + c3->tot.cnfc + c3->tot.capc
+  );
+  err |= test_check(fp, "SET 0",
+    7 == set0.cmpc && 27 == set0.cnfc && 4 == set0.capc
+  );
+
+  c3    = cache_c3_dtor(c3);
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* nonzero when both caches see the same hits and misses on one trace */
+
+int test_same (
+  struct cache_t * cache,
+  struct cache_t * ref,
+  u_word_t         accc
+)
+{
+  u_long_t seed     = U_LONG(1);
+  u_long_t ref_seed = U_LONG(1);
+  u_word_t acci;
+
+  /* resets keep the counters, so compare what this trace adds */
+
+  u_long_t hitc = cache->rd_hitc + cache->wr_hitc;
+  u_long_t misc = cache->rd_misc + cache->wr_misc;
+
+  hitc -= ref->rd_hitc + ref->wr_hitc;
+  misc -= ref->rd_misc + ref->wr_misc;
+
+  cache_reset(cache, NULL);
+  cache_reset(ref, NULL);
+
+  for (acci = U_WORD(0); acci < accc; ++acci) {
+    if (test_access(cache, &seed) != test_access(ref, &ref_seed))
+      return 0;
+  }
+
+  return (
+    cache->rd_hitc + cache->wr_hitc - ref->rd_hitc - ref->wr_hitc == hitc &&
+    cache->rd_misc + cache->wr_misc - ref->rd_misc - ref->wr_misc == misc
+  );
+}
+
+int test_wp (
+  FILE * fp
+)
+{
+  char * argv [] = {
+    "--geom", "32:6:8:6", "--policy", "lru", "--flush", "none"
+  };
+  char * skew [] = {
+    "--geom", "32:6:8:6", "--index", "skew:2"
+  };
+
+  struct cache_t   cache = { 0 };
+  struct cache_t   bad   = { 0 };
+  struct cache_t * ref   = cache_ctor(NULL, 6, argv);
+  u_word_t         acci;
+  int              err   = 0;
+
+  cache_set_wp(&cache);
+  cache_set_wp(&bad);
+
+  if (!ref || !cache_ctor(&cache, 6, argv)) {
+    ref = cache_dtor(ref);
+    return CACHE_TEST_FAILED;
+  }
+
+  fprintf(fp, "TEST WAY PREDICTION\n");
+  fprintf(fp, ".-------------------\n");
+
+  err |= test_check(fp, "REJECTS SKEWED INDEXING", !cache_ctor(&bad, 4, skew));
+
+  /* one line read over and over, then two lines of a set in turn */
+
+  cache_reset(&cache, NULL);
+
+  for (acci = U_WORD(0); acci < 11; ++acci) {
+    if (CACHE_FAILURE == cache_read(&cache, 0, 1, NULL)) {
+      cache_fill(&cache, 0, NULL);
+    }
+  }
+
+  err |= test_check(fp, "PREDICTS THE LAST WAY",
+    10 == cache.wp_hitc && 0 == cache.wp_misc && 10 == cache.wp_prbc
+  );
+
+  for (acci = U_WORD(0); acci < 11; ++acci) {
+    u_long_t adr = acci % 2 ? 0 : 64 * 64;
+
+    if (CACHE_FAILURE == cache_read(&cache, adr, 1, NULL)) {
+      cache_fill(&cache, adr, NULL);
+    }
+  }
+
+  struct cache_stat_t stat;
+
+  cache_stat(&cache, &stat);
+
+  err |= test_check(fp, "MISPREDICTS ALTERNATING WAYS",
+    10 == cache.wp_hitc && 10 == cache.wp_misc && 0.5 == stat.wp_rate
+  );
+
+  err |= test_check(fp, "SAME HITS AS WITHOUT", test_same(&cache, ref, 20000));
+  err |= test_check(fp, "EVERY HIT PREDICTED OR NOT",
+    cache.wp_hitc + cache.wp_misc == cache.rd_hitc + cache.wr_hitc &&
+    cache.wp_hitc <= cache.wp_prbc
+  );
+
+  cache_dtor(&cache);
+  ref = cache_dtor(ref);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/*
+ * 4096 random lines over 8 and 12 ways: many of them share a partial tag
+ * within a set, and 12 ways leave a partly used word of partial tags.
+ */
+
+int test_pt (
+  FILE * fp
+)
+{
+  char * argv8  [] = { "--geom", "32:6:8:6", "--policy", "lru" };
+  char * argv12 [] = { "--geom", "32:5:12:6", "--policy", "lru" };
+  char * skew   [] = { "--geom", "32:6:8:6", "--index", "skew:2" };
+
+  struct cache_t   pt8  = { 0 };
+  struct cache_t   pt12 = { 0 };
+  struct cache_t   bad  = { 0 };
+  struct cache_t * ref8  = cache_ctor(NULL, 4, argv8);
+  struct cache_t * ref12 = cache_ctor(NULL, 4, argv12);
+  int              err  = 0;
+
+  cache_set_pt(&pt8);
+  cache_set_pt(&pt12);
+  cache_set_pt(&bad);
+
+  fprintf(fp, "TEST PARTIAL TAGS\n");
+  fprintf(fp, ".-----------------\n");
+
+  err |= test_check(fp, "REJECTS SKEWED INDEXING", !cache_ctor(&bad, 4, skew));
+
+  if (ref8 && cache_ctor(&pt8, 4, argv8)) {
+    err |= test_check(fp, "SAME HITS AS FULL TAGS, 8 WAYS",
+      test_same(&pt8, ref8, 50000)
+    );
+    err |= test_check(fp, "ONE PARTIAL TAG WORD, 8 WAYS", 8 == pt8.ptgz);
+
+    cache_dtor(&pt8);
+  } else {
+    err |= test_check(fp, "8 WAYS", 0);
+  }
+
+  if (ref12 && cache_ctor(&pt12, 4, argv12)) {
+    err |= test_check(fp, "SAME HITS AS FULL TAGS, 12 WAYS",
+      test_same(&pt12, ref12, 50000)
+    );
+
+    cache_dtor(&pt12);
+  } else {
+    err |= test_check(fp, "12 WAYS", 0);
+  }
+
+  ref8  = cache_dtor(ref8);
+  ref12 = cache_dtor(ref12);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+int test_probe (
+  FILE * fp
+)
+{
+  /* a single set of 4 LRU ways, lines A to E */
+
+  char * argv [] = {
+    "--geom", "32:0:4:6", "--policy", "lru", "--flush", "none"
+  };
+
+  struct cache_t * cache = cache_ctor(NULL, 6, argv);
+  u_long_t         hitc;
+  u_word_t         lini;
+  int              err   = 0;
+
+  if (!cache)
+    return CACHE_TEST_FAILED;
+
+  cache_reset(cache, NULL);
+
+  fprintf(fp, "TEST FUSED PROBE\n");
+  fprintf(fp, ".----------------\n");
+
+  for (lini = U_WORD(0); lini < 4; ++lini) {
+    if (CACHE_FAILURE == cache_read(cache, lini * 64, 1, NULL)) {
+      cache_fill(cache, lini * 64, NULL);
+    }
+  }
+
+  for (lini = U_WORD(0); lini < 4; ++lini) {
+    cache_read(cache, lini * 64, 1, NULL);
+  }
+
+  err |= test_check(fp, "FREE WAYS BEFORE VICTIMS",
+    4 == cache->rd_misc && 4 == cache->rd_hitc
+  );
+
+  /* A again leaves B least recently used, so a write of E takes its way */
+
+  cache_read(cache, 0, 1, NULL);
+  cache_write(cache, 4 * 64, 1, NULL);
+
+  hitc = cache->rd_hitc;
+
+  int res = cache_read(cache, 1 * 64, 1, NULL);
+
+  err |= test_check(fp, "WRITE MISS EVICTS THE LRU WAY",
+    1 == cache->wr_misc && CACHE_FAILURE == res && hitc == cache->rd_hitc
+  );
+
+  /* B went back in place of C, the least recently used after E */
+
+  cache_fill(cache, 1 * 64, NULL);
+
+  u_word_t hitm = U_WORD(0);
+
+  for (lini = U_WORD(0); lini < 5; ++lini) {
+    if (CACHE_SUCCESS == cache_read(cache, lini * 64, 1, NULL)) {
+      hitm |= U_WORD(1) << lini;
+    }
+  }
+
+  err |= test_check(fp, "FILL EVICTS THE LRU WAY", 0x1B == hitm);
+
+  cache_write(cache, 0, 1, NULL);
+
+  err |= test_check(fp, "WRITE HIT ALLOCATES NOTHING",
+    1 == cache->wr_hitc && 1 == cache->wr_misc &&
+    CACHE_SUCCESS == cache_read(cache, 3 * 64, 1, NULL)
+  );
+
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+int test_packed (
+  FILE * fp
+)
+{
+  /* 26-bit tags: 5 header bytes a way, or 32 packed bits with LRU */
+
+  char * lru    [] = { "--geom", "40:8:16:6", "--policy", "lru" };
+  char * plru   [] = { "--geom", "40:8:16:6", "--policy", "plru" };
+  char * random [] = { "--geom", "40:8:16:6", "--policy", "random" };
+
+  char ** argvv [] = { lru, plru, random };
+
+  struct cache_t bad = { 0 };
+  u_word_t       argi, adri;
+  int            same = 1;
+  int            err  = 0;
+
+  fprintf(fp, "TEST PACKED HEADERS\n");
+  fprintf(fp, ".-------------------\n");
+
+  for (argi = U_WORD(0); argi < 3; ++argi) {
+    struct cache_t   ph  = { 0 };
+    struct cache_t * ref = cache_ctor(NULL, 4, argvv[argi]);
+
+    cache_set_ph(&ph);
+
+    if (!ref || !cache_ctor(&ph, 4, argvv[argi])) {
+      ref  = cache_dtor(ref);
+      same = 0;
+      continue;
+    }
+
+    same &= test_same(&ph, ref, 50000);
+
+    /* and the same data in every line both still hold */
+
+    for (adri = U_WORD(0); adri < 4096; ++adri) {
+      u_byte_t buf [64];
+      u_byte_t ref_buf [64];
+
+      int res = cache_read(&ph, (u_long_t)adri * 64, 64, buf);
+
+      if (res != cache_read(ref, (u_long_t)adri * 64, 64, ref_buf)) {
+        same = 0;
+      } else if (CACHE_SUCCESS == res) {
+        same &= 0 == memcmp(buf, ref_buf, sizeof(buf));
+      }
+    }
+
+    if (!argi) {
+      err |= test_check(fp, "SMALLER SETS",
+        64 == ph.pkz && ph.pkz < ref->hdr_len && ph.tot_len < ref->tot_len
+      );
+    }
+
+    cache_dtor(&ph);
+    ref = cache_dtor(ref);
+  }
+
+  err |= test_check(fp, "SAME HITS AND DATA AS UNPACKED", same);
+
+  bad.secc = 4;
+  cache_set_ph(&bad);
+
+  err |= test_check(fp, "REJECTS SECTORS", !cache_ctor(&bad, 4, lru));
+
+  memset(&bad, 0, sizeof(bad));
+  cache_set_ph(&bad);
+  cache_set_cc(&bad);
+
+  err |= test_check(fp, "REJECTS CONCURRENT MODE", !cache_ctor(&bad, 4, lru));
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+/* the host may expose no counter at all, which must not fail a profile */
+
+int test_prof (
+  FILE * fp
+)
+{
+  char * argv [] = { "--geom", "32:6:8:6", "--policy", "lru" };
+
+  struct cache_prof_t prof;
+  u_long_t            valv [CACHE_PROF_CNTC];
+  u_long_t            seed  = U_LONG(1);
+  u_word_t            cnti, acci;
+  int                 named = 1;
+  int                 err   = 0;
+
+  struct cache_t * cache = cache_ctor(NULL, 4, argv);
+
+  if (!cache || !cache_prof_ctor(&prof)) {
+    cache = cache_dtor(cache);
+    return CACHE_TEST_FAILED;
+  }
+
+  cache_reset(cache, NULL);
+
+  fprintf(fp, "TEST PROFILING\n");
+  fprintf(fp, ".--------------\n");
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    named &= (
+      0 != strcmp(cache_prof_name(cnti), "UNKNOWN") &&
+      (!cnti || 0 != strcmp(cache_prof_name(cnti), cache_prof_name(0)))
+    );
+  }
+
+  err |= test_check(fp, "COUNTER NAMES",
+    named && 0 == strcmp(cache_prof_name(CACHE_PROF_CNTC), "UNKNOWN")
+  );
+
+  int avl = !(prof.avlm >> CACHE_PROF_CNTC);
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    avl &= !cache_prof_get_avl(&prof, cnti) == (prof.fdv[cnti] < 0);
+  }
+
+  err |= test_check(fp, "AVAILABLE COUNTERS HAVE A FILE", avl);
+
+  cache_prof_start(&prof);
+
+  for (acci = U_WORD(0); acci < 10000; ++acci) {
+    test_access(cache, &seed);
+  }
+
+  cache_prof_stop(&prof);
+  memcpy(valv, prof.valv, sizeof(valv));
+  cache_prof_start(&prof);
+
+  for (acci = U_WORD(0); acci < 10000; ++acci) {
+    test_access(cache, &seed);
+  }
+
+  cache_prof_stop(&prof);
+
+  int acc = 1;
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    acc &= cache_prof_get_avl(&prof, cnti) ? (
+      valv[cnti] <= prof.valv[cnti]
+    ) : (
+      !prof.valv[cnti]
+    );
+  }
+
+  err |= test_check(fp, "COUNTS ACCUMULATE", acc);
+  err |= test_check(fp, "INSTRUCTIONS COUNTED",
+    !cache_prof_get_avl(&prof, CACHE_PROF_INSNS) ||
+    valv[CACHE_PROF_INSNS] < prof.valv[CACHE_PROF_INSNS]
+  );
+
+  fprintf(fp, "| %-40s 0x%" U_WORD_FMTX "\n", "AVAILABLE", prof.avlm);
+
+  cache_prof_dtor(&prof);
+
+  err |= test_check(fp, "CLOSED", !prof.avlm && prof.fdv[0] < 0);
+
+  cache = cache_dtor(cache);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
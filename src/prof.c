@@ -0,0 +1,170 @@
+# include "prof.h"
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+
+# if defined(__linux__) && defined(__has_include)
+#   if __has_include(<linux/perf_event.h>)
+#     include <linux/perf_event.h>
+#     include <sys/ioctl.h>
+#     include <sys/syscall.h>
+#     define _PROF_PERF
+#   endif
+# endif
+
+# ifdef _PROF_PERF
+
+static const u_long_t _cache_prof_cfgv[CACHE_PROF_CNTC][2] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES    },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS  },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES  },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+static int _cache_prof_open (
+  _In    u_word_t cnti
+)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = (u_word_t)_cache_prof_cfgv[cnti][0];
+  attr.config         = _cache_prof_cfgv[cnti][1];
+  attr.disabled       = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = (
+    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+  );
+
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+# endif
+
+struct cache_prof_t * cache_prof_ctor (
+  _InOut struct cache_prof_t * prof
+)
+{
+  if (!prof) {
+    prof = (struct cache_prof_t *)malloc(sizeof(struct cache_prof_t));
+
+    if (!prof)
+      return prof;
+
+    prof->sr = 0;
+    cache_prof_set_ho(prof);
+  } else {
+    prof->sr = 0;
+  }
+
+  u_word_t cnti;
+
+  prof->avlm = U_WORD(0);
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    prof->valv[cnti] = U_LONG(0);
+# ifdef _PROF_PERF
+    prof->fdv[cnti]  = _cache_prof_open(cnti);
+# else
+    prof->fdv[cnti]  = -1;
+# endif
+
+    if (0 <= prof->fdv[cnti]) {
+      prof->avlm |= U_WORD(1) << cnti;
+    }
+  }
+
+  return prof;
+}
+
+struct cache_prof_t * cache_prof_dtor (
+  _InOut struct cache_prof_t * prof
+)
+{
+  if (!prof)
+    return prof;
+
+  u_word_t cnti;
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    if (0 <= prof->fdv[cnti]) {
+      close(prof->fdv[cnti]);
+      prof->fdv[cnti] = -1;
+    }
+  }
+
+  prof->avlm = U_WORD(0);
+
+  if (cache_prof_get_ho(prof)) {
+    free(prof);
+    prof = NULL;
+  }
+
+  return prof;
+}
+
+void cache_prof_start (
+  _InOut struct cache_prof_t * prof
+)
+{
+# ifdef _PROF_PERF
+  u_word_t cnti;
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    if (!cache_prof_get_avl(prof, cnti))
+      continue;
+
+    ioctl(prof->fdv[cnti], PERF_EVENT_IOC_RESET, 0);
+    ioctl(prof->fdv[cnti], PERF_EVENT_IOC_ENABLE, 0);
+  }
+# else
+  (void)prof;
+# endif
+}
+
+void cache_prof_stop (
+  _InOut struct cache_prof_t * prof
+)
+{
+# ifdef _PROF_PERF
+  u_word_t cnti;
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    if (!cache_prof_get_avl(prof, cnti))
+      continue;
+
+    ioctl(prof->fdv[cnti], PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    u_long_t val[3]; /* value, time enabled, time running */
+
+    if (!cache_prof_get_avl(prof, cnti))
+      continue;
+
+    if (sizeof(val) != read(prof->fdv[cnti], val, sizeof(val)))
+      continue;
+
+    if (val[2] && val[2] < val[1]) {
+      val[0] = (u_long_t)((double)val[0] * (double)val[1] / (double)val[2]);
+    }
+
+    prof->valv[cnti] += val[0];
+  }
+# else
+  (void)prof;
+# endif
+}
+
+const char * cache_prof_name (
+  _In    u_word_t cnti
+)
+{
+  static const char * namev[CACHE_PROF_CNTC] = {
+    "CYCLES", "INSNS", "LLC MISSES", "BR MISSES"
+  };
+
+  return cnti < CACHE_PROF_CNTC ? namev[cnti] : "UNKNOWN";
+}
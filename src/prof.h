@@ -0,0 +1,56 @@
+# ifndef __PROF_H
+#   define __PROF_H
+
+#   include "cache.h"
+
+/*
+ * Host self-profiling: hardware counters of the calling thread, read with
+ * `perf_event_open` around a simulation phase, user space only. Counters
+ * the host does not expose (no PMU, a virtual machine, a restrictive
+ * `perf_event_paranoid`) are left out of `avlm` and report nothing, so a
+ * profile never fails for lack of counters. Multiplexed counters are
+ * scaled by their enabled and running times.
+ */
+
+#   define CACHE_PROF_CYCLES     0
+#   define CACHE_PROF_INSNS      1
+#   define CACHE_PROF_LLC_MISSES 2
+#   define CACHE_PROF_BR_MISSES  3
+#   define CACHE_PROF_CNTC       4
+
+struct cache_prof_t {
+  u_word_t sr;
+  u_word_t avlm; /* available counters */
+  int      fdv[CACHE_PROF_CNTC];
+  u_long_t valv[CACHE_PROF_CNTC];
+};
+
+#   define cache_prof_clr_ho(prof) (prof)->sr &= ~0x1
+#   define cache_prof_set_ho(prof) (prof)->sr |= 0x1
+#   define cache_prof_get_ho(prof) ((prof)->sr & 0x1)
+
+#   define cache_prof_get_avl(prof, cnti) ((prof)->avlm & (U_WORD(1) << (cnti)))
+
+struct cache_prof_t * cache_prof_ctor (
+  _InOut struct cache_prof_t * prof
+);
+
+struct cache_prof_t * cache_prof_dtor (
+  _InOut struct cache_prof_t * prof
+);
+
+/* counts accumulate in `valv` over every start/stop pair */
+
+void cache_prof_start (
+  _InOut struct cache_prof_t * prof
+);
+
+void cache_prof_stop (
+  _InOut struct cache_prof_t * prof
+);
+
+const char * cache_prof_name (
+  _In    u_word_t cnti
+);
+
+# endif
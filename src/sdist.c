@@ -0,0 +1,362 @@
+# include "sdist.h"
+# include <stdlib.h>
+# include <string.h>
+
+# define _SDIST_EMPTY U_LONG_MAX
+
+static void _cache_sdist_lvl_free (
+  _InOut struct cache_sdist_lvl_t * lvl
+)
+{
+  free(lvl->clk_buf);
+  free(lvl->bit_buf);
+  free(lvl->tag_buf);
+  free(lvl->hash_key);
+  free(lvl->hash_val);
+  free(lvl->hist);
+  memset(lvl, 0, sizeof(*lvl));
+}
+
+static int _cache_sdist_lvl_init (
+  _InOut struct cache_sdist_lvl_t * lvl,
+  _In    u_word_t                   sets,
+  _In    u_word_t                   depth
+)
+{
+  lvl->sets  = sets;
+  lvl->setc  = U_WORD(1) << sets;
+  lvl->setm  = lvl->setc - U_WORD(1);
+  lvl->slotc = depth * U_WORD(2);
+
+  size_t slotc = (size_t)lvl->setc * lvl->slotc;
+
+  lvl->hashz = U_WORD(1);
+
+  while ((U_LONG(1) << lvl->hashz) < U_LONG(2) * slotc) {
+    ++lvl->hashz;
+  }
+
+  lvl->hashm = (U_LONG(1) << lvl->hashz) - U_LONG(1);
+
+  lvl->clk_buf  = (u_word_t *)calloc(lvl->setc, sizeof(u_word_t));
+  lvl->bit_buf  = (u_word_t *)calloc(slotc, sizeof(u_word_t));
+  lvl->tag_buf  = (u_long_t *)malloc(slotc * sizeof(u_long_t));
+  lvl->hash_key = (u_long_t *)malloc((lvl->hashm + 1) * sizeof(u_long_t));
+  lvl->hash_val = (u_word_t *)malloc((lvl->hashm + 1) * sizeof(u_word_t));
+  lvl->hist     = (u_long_t *)calloc(depth + 1, sizeof(u_long_t));
+
+  if (
+    !lvl->clk_buf  || !lvl->bit_buf  || !lvl->tag_buf ||
+    !lvl->hash_key || !lvl->hash_val || !lvl->hist
+  ) {
+    _cache_sdist_lvl_free(lvl);
+    return CACHE_FAILURE;
+  }
+
+  memset(lvl->tag_buf,  0xFF, slotc * sizeof(u_long_t));
+  memset(lvl->hash_key, 0xFF, (lvl->hashm + 1) * sizeof(u_long_t));
+
+  return CACHE_SUCCESS;
+}
+
+struct cache_sdist_t * cache_sdist_ctor (
+  _InOut struct cache_sdist_t * sd,
+  _In    u_word_t               dats,
+  _In    u_word_t               sets_lo,
+  _In    u_word_t               sets_hi,
+  _In    u_word_t               depth
+)
+{
+  if (sets_hi < sets_lo || !depth || 64 <= dats + sets_hi)
+    return NULL;
+
+  if (!sd) {
+    sd = (struct cache_sdist_t *)malloc(
+      sizeof(struct cache_sdist_t)
+    );
+
+    if (!sd)
+      return sd;
+
+    sd->sr = 0;
+    cache_sdist_set_ho(sd);
+  } else {
+    sd->sr = 0;
+  }
+
+  sd->dats    = dats;
+  sd->sets_lo = sets_lo;
+  sd->sets_hi = sets_hi;
+  sd->depth   = depth;
+  sd->lvlc    = sets_hi - sets_lo + U_WORD(1);
+  sd->accc    = U_LONG(0);
+  sd->lvlv    = (struct cache_sdist_lvl_t *)calloc(
+    sd->lvlc, sizeof(struct cache_sdist_lvl_t)
+  );
+
+  if (!sd->lvlv) {
+    sd = cache_sdist_dtor(sd);
+    return NULL;
+  }
+
+  u_word_t lvli;
+
+  for (lvli = U_WORD(0); lvli < sd->lvlc; ++lvli) {
+    int res = _cache_sdist_lvl_init(
+      sd->lvlv + lvli, sets_lo + lvli, depth
+    );
+
+    if (res) {
+      sd = cache_sdist_dtor(sd);
+      return NULL;
+    }
+  }
+
+  return sd;
+}
+
+struct cache_sdist_t * cache_sdist_dtor (
+  _InOut struct cache_sdist_t * sd
+)
+{
+  if (!sd)
+    return sd;
+
+  if (sd->lvlv) {
+    u_word_t lvli;
+
+    for (lvli = U_WORD(0); lvli < sd->lvlc; ++lvli) {
+      _cache_sdist_lvl_free(sd->lvlv + lvli);
+    }
+
+    free(sd->lvlv);
+    sd->lvlv = NULL;
+  }
+
+  if (cache_sdist_get_ho(sd)) {
+    free(sd);
+    sd = NULL;
+  }
+
+  return sd;
+}
+
+/* Fenwick tree over the timestamp slots of one set */
+
+static void _cache_sdist_bit_add (
+  _InOut u_word_t * bit,
+  _In    u_word_t   len,
+  _In    u_word_t   idx,
+  _In    u_word_t   val
+)
+{
+  for (++idx; idx <= len; idx += idx & (~idx + 1)) {
+    bit[idx - 1] += val;
+  }
+}
+
+static u_word_t _cache_sdist_bit_sum (
+  _In    const u_word_t * bit,
+  _In    u_word_t         idx
+)
+{
+  u_word_t sum = U_WORD(0);
+
+  for (++idx; idx; idx -= idx & (~idx + 1)) {
+    sum += bit[idx - 1];
+  }
+
+  return sum;
+}
+
+/* open addressing map from line address to slot */
+
+static u_long_t _cache_sdist_hash_find (
+  _In    const struct cache_sdist_lvl_t * lvl,
+  _In    u_long_t                         key
+)
+{
+  u_long_t idx = (
+    key * U_LONG(0x9E3779B97F4A7C15)
+  ) >> (64 - lvl->hashz);
+
+  while (_SDIST_EMPTY != lvl->hash_key[idx] && key != lvl->hash_key[idx]) {
+    idx = (idx + 1) & lvl->hashm;
+  }
+
+  return idx;
+}
+
+static void _cache_sdist_hash_del (
+  _InOut struct cache_sdist_lvl_t * lvl,
+  _In    u_long_t                   idx
+)
+{
+  u_long_t nxt = idx;
+
+  for (;;) {
+    nxt = (nxt + 1) & lvl->hashm;
+
+    if (_SDIST_EMPTY == lvl->hash_key[nxt])
+      break;
+
+    u_long_t home = (
+      lvl->hash_key[nxt] * U_LONG(0x9E3779B97F4A7C15)
+    ) >> (64 - lvl->hashz);
+
+    /* keep entries whose home lies cyclically in ( idx, nxt ] */
+
+    if (((nxt - home) & lvl->hashm) < ((nxt - idx) & lvl->hashm))
+      continue;
+
+    lvl->hash_key[idx] = lvl->hash_key[nxt];
+    lvl->hash_val[idx] = lvl->hash_val[nxt];
+    idx = nxt;
+  }
+
+  lvl->hash_key[idx] = _SDIST_EMPTY;
+}
+
+static void _cache_sdist_compact (
+  _InOut struct cache_sdist_lvl_t * lvl,
+  _In    u_word_t                   seti,
+  _In    u_word_t                   depth
+)
+{
+  u_long_t * tag = lvl->tag_buf + (size_t)seti * lvl->slotc;
+  u_word_t * bit = lvl->bit_buf + (size_t)seti * lvl->slotc;
+  u_word_t   clk = lvl->clk_buf[seti];
+  u_word_t   live, drop, slot, dsti;
+
+  live = _cache_sdist_bit_sum(bit, clk - U_WORD(1));
+  drop = depth < live ? live - depth : U_WORD(0);
+
+  memset(bit, 0, lvl->slotc * sizeof(u_word_t));
+
+  for (slot = dsti = U_WORD(0); slot < clk; ++slot) {
+    if (_SDIST_EMPTY == tag[slot])
+      continue;
+
+    u_long_t hidx = _cache_sdist_hash_find(lvl, tag[slot]);
+
+    if (drop) {
+      --drop;
+      _cache_sdist_hash_del(lvl, hidx);
+    } else {
+      lvl->hash_val[hidx] = dsti;
+      tag[dsti] = tag[slot];
+      _cache_sdist_bit_add(bit, lvl->slotc, dsti, U_WORD(1));
+      ++dsti;
+    }
+  }
+
+  for (slot = dsti; slot < clk; ++slot) {
+    tag[slot] = _SDIST_EMPTY;
+  }
+
+  lvl->clk_buf[seti] = dsti;
+}
+
+void cache_sdist_access (
+  _InOut struct cache_sdist_t * sd,
+  _In    u_long_t               adr
+)
+{
+  u_long_t lin = adr >> sd->dats;
+  u_word_t lvli;
+
+  ++sd->accc;
+
+  for (lvli = U_WORD(0); lvli < sd->lvlc; ++lvli) {
+    struct cache_sdist_lvl_t * lvl = sd->lvlv + lvli;
+
+    u_word_t   seti = (u_word_t)lin & lvl->setm;
+    u_long_t * tag  = lvl->tag_buf + (size_t)seti * lvl->slotc;
+    u_word_t * bit  = lvl->bit_buf + (size_t)seti * lvl->slotc;
+    u_long_t   hidx = _cache_sdist_hash_find(lvl, lin);
+
+    if (_SDIST_EMPTY != lvl->hash_key[hidx]) {
+      u_word_t slot = lvl->hash_val[hidx];
+      u_word_t dist = (
+        _cache_sdist_bit_sum(bit, lvl->clk_buf[seti] - U_WORD(1)) -
+        _cache_sdist_bit_sum(bit, slot)
+      );
+
+      ++lvl->hist[dist < sd->depth ? dist : sd->depth];
+      _cache_sdist_bit_add(bit, lvl->slotc, slot, ~U_WORD(0));
+      tag[slot] = _SDIST_EMPTY;
+    } else {
+      ++lvl->hist[sd->depth];
+    }
+
+    if (lvl->clk_buf[seti] == lvl->slotc) {
+      _cache_sdist_compact(lvl, seti, sd->depth);
+    }
+
+    u_word_t slot = lvl->clk_buf[seti]++;
+
+    tag[slot] = lin;
+    _cache_sdist_bit_add(bit, lvl->slotc, slot, U_WORD(1));
+
+    hidx = _cache_sdist_hash_find(lvl, lin);
+    lvl->hash_key[hidx] = lin;
+    lvl->hash_val[hidx] = slot;
+  }
+}
+
+u_long_t cache_sdist_misses (
+  _In    const struct cache_sdist_t * sd,
+  _In    u_word_t                     sets,
+  _In    u_word_t                     wayc
+)
+{
+  if (sets < sd->sets_lo || sd->sets_hi < sets || sd->depth < wayc)
+    return U_LONG_MAX;
+
+  const struct cache_sdist_lvl_t * lvl = sd->lvlv + (sets - sd->sets_lo);
+
+  u_long_t misc = U_LONG(0);
+  u_word_t dist;
+
+  for (dist = wayc; dist <= sd->depth; ++dist) {
+    misc += lvl->hist[dist];
+  }
+
+  return misc;
+}
+
+void cache_sdist_print (
+  _In    const struct cache_sdist_t * sd,
+  _Out   FILE *                       fp
+)
+{
+  u_word_t sets, wayc;
+
+  fprintf(
+    fp,
+    "STACK DISTANCE (%" U_LONG_FMTD " ACCESSES, %" U_WORD_FMTD " BYTE LINES)\n"
+    "| SETS    ",
+    sd->accc, U_WORD(1) << sd->dats
+  );
+
+  for (wayc = U_WORD(1); wayc <= sd->depth; wayc <<= 1) {
+    fprintf(fp, " %8" U_WORD_FMTD "W", wayc);
+  }
+
+  fprintf(fp, "\n");
+
+  for (sets = sd->sets_lo; sets <= sd->sets_hi; ++sets) {
+    fprintf(fp, "| %8" U_WORD_FMTD, U_WORD(1) << sets);
+
+    for (wayc = U_WORD(1); wayc <= sd->depth; wayc <<= 1) {
+      u_long_t misc = cache_sdist_misses(sd, sets, wayc);
+
+      fprintf(
+        fp, " %9.6f",
+        sd->accc ? (double)misc / (double)sd->accc : 0.0
+      );
+    }
+
+    fprintf(fp, "\n");
+  }
+}
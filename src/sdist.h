@@ -0,0 +1,75 @@
+# ifndef __SDIST_H
+#   define __SDIST_H
+
+#   include "cache.h"
+
+/*
+ * LRU stack-distance analysis. One pass over a trace yields the exact LRU
+ * miss count of every associativity up to `depth` ways, for every set count
+ * between `1 << sets_lo` and `1 << sets_hi` sets, with `1 << dats` byte lines.
+ *
+ * Each set keeps a window of `2 * depth` timestamp slots indexed by a Fenwick
+ * tree, so the distance of a reuse is counted in O(log depth). When a set
+ * runs out of slots the window is compacted and the lines deeper than
+ * `depth` are dropped, since they miss in every tracked associativity.
+ */
+
+struct cache_sdist_lvl_t {
+  u_word_t   sets; /* in bits  */
+  u_word_t   setc; /* in sets  */
+  u_word_t   setm;
+  u_word_t   slotc;
+  u_word_t * clk_buf;
+  u_word_t * bit_buf;
+  u_long_t * tag_buf;
+  u_word_t   hashz; /* in bits */
+  u_long_t   hashm;
+  u_long_t * hash_key;
+  u_word_t * hash_val;
+  u_long_t * hist;
+};
+
+struct cache_sdist_t {
+  u_word_t                   sr;
+  u_word_t                   dats;    /* in bits */
+  u_word_t                   sets_lo; /* in bits */
+  u_word_t                   sets_hi; /* in bits */
+  u_word_t                   depth;   /* in ways */
+  u_word_t                   lvlc;
+  struct cache_sdist_lvl_t * lvlv;
+  u_long_t                   accc;
+};
+
+#   define cache_sdist_clr_ho(sd) (sd)->sr &= ~0x1
+#   define cache_sdist_set_ho(sd) (sd)->sr |= 0x1
+#   define cache_sdist_get_ho(sd) ((sd)->sr & 0x1)
+
+struct cache_sdist_t * cache_sdist_ctor (
+  _InOut struct cache_sdist_t * sd,
+  _In    u_word_t               dats,
+  _In    u_word_t               sets_lo,
+  _In    u_word_t               sets_hi,
+  _In    u_word_t               depth
+);
+
+struct cache_sdist_t * cache_sdist_dtor (
+  _InOut struct cache_sdist_t * sd
+);
+
+void cache_sdist_access (
+  _InOut struct cache_sdist_t * sd,
+  _In    u_long_t               adr
+);
+
+u_long_t cache_sdist_misses (
+  _In    const struct cache_sdist_t * sd,
+  _In    u_word_t                     sets,
+  _In    u_word_t                     wayc
+);
+
+void cache_sdist_print (
+  _In    const struct cache_sdist_t * sd,
+  _Out   FILE *                       fp
+);
+
+# endif
@@ -0,0 +1,765 @@
+# include "cache.h"
+# include "prof.h"
+# include "sdist.h"
+# include <pthread.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+/*
+ * Parameter sweep: replays one trace against every combination of the
+ * given geometries and policies. The trace is decoded once into an array
+ * shared read-only by all workers, and the configurations are scheduled on
+ * a work-stealing pool: each worker owns a range of configurations, takes
+ * from its front and, once empty, steals the back half of another range.
+ *
+ * Trace lines are `R|W|F ADDRESS [LENGTH]`, with a hexadecimal address and
+ * `#` starting a comment. `F` installs a clean line, like a prefetch.
+ *
+ * With `--profile` the decode and every replay are bracketed by the host
+ * counters of prof.h, reported per simulated access. With `--sdist` the
+ * reads and writes of the trace also go through one LRU stack-distance
+ * pass, whose table gives the LRU misses of every set count and
+ * associativity in its range; fills are not replayed there.
+ *
+ * Every configuration draws its random victims from a generator of its
+ * own, seeded with `--seed`, so the table does not depend on the number
+ * of workers nor on the order they run in. `--test` checks just that, and
+ * the LRU rows against the stack distances, on a generated trace.
+ */
+
+# define _SWEEP_RD 0
+# define _SWEEP_WR 1
+# define _SWEEP_FL 2
+
+struct sweep_acc_t {
+  u_long_t adr;
+  u_word_t len;
+  u_word_t op;
+};
+
+struct sweep_cfg_t {
+  const char * geom;
+  const char * policy;
+  int          res;
+  u_long_t     accc;
+  u_long_t     rd_hitc;
+  u_long_t     rd_misc;
+  u_long_t     wr_hitc;
+  u_long_t     wr_misc;
+  double       secs;
+  u_word_t     prf_avlm;
+  u_long_t     prf_valv[CACHE_PROF_CNTC];
+};
+
+struct sweep_deq_t {
+  pthread_mutex_t mtx;
+  u_word_t        lo;
+  u_word_t        hi;
+};
+
+struct sweep_t {
+  const struct sweep_acc_t * accv;
+  size_t                     accc;
+  struct sweep_cfg_t *       cfgv;
+  u_word_t                   cfgc;
+  struct sweep_deq_t *       deqv;
+  u_word_t                   deqc;
+  int                        prf;
+  const char *               seed;
+};
+
+struct sweep_worker_t {
+  struct sweep_t * sw;
+  u_word_t         wrki;
+};
+
+static int _sweep_decode (
+  _In    const char *          path,
+  _Out   struct sweep_acc_t ** _accv,
+  _Out   size_t *              _accc
+)
+{
+  FILE * fp = 0 == strcmp(path, "-") ? stdin : fopen(path, "r");
+
+  if (!fp)
+    return CACHE_FAILURE;
+
+  struct sweep_acc_t * accv = NULL;
+  size_t               accc = 0;
+  size_t               accz = 0;
+  char                 line[256];
+  int                  res  = CACHE_SUCCESS;
+
+  while (fgets(line, sizeof(line), fp)) {
+    char *   cmt = strchr(line, '#');
+    char     op;
+    u_long_t adr;
+    u_word_t len = U_WORD(1);
+
+    if (cmt)
+      *cmt = '\0';
+
+    int argc = sscanf(
+      line, " %c %" SCNx64 " %" SCNu32, &op, &adr, &len
+    );
+
+    if (argc <= 0)
+      continue;
+
+    if (argc < 2 || !len || !strchr("RrWwFf", op)) {
+      res = CACHE_FAILURE;
+      break;
+    }
+
+    if (accc == accz) {
+      accz = accz ? accz * 2 : 4096;
+
+      struct sweep_acc_t * tmp = (struct sweep_acc_t *)realloc(
+        accv, accz * sizeof(struct sweep_acc_t)
+      );
+
+      if (!tmp) {
+        res = CACHE_FAILURE;
+        break;
+      }
+
+      accv = tmp;
+    }
+
+    accv[accc].adr = adr;
+    accv[accc].len = len;
+    accv[accc].op  = (
+      'R' == op || 'r' == op ? _SWEEP_RD :
+      'W' == op || 'w' == op ? _SWEEP_WR : _SWEEP_FL
+    );
+    ++accc;
+  }
+
+  if (stdin != fp)
+    fclose(fp);
+
+  if (res) {
+    free(accv);
+    return res;
+  }
+
+  *_accv = accv;
+  *_accc = accc;
+  return CACHE_SUCCESS;
+}
+
+static void _sweep_run (
+  _In    const struct sweep_t * sw,
+  _InOut struct sweep_cfg_t *   cfg
+)
+{
+  /* miss rates only: no line data is kept or copied */
+
+  char * argv[] = {
+    "--geom",   (char *)cfg->geom,
+    "--policy", (char *)cfg->policy,
+    "--seed",   (char *)sw->seed,
+    "--flush",  "none",
+    "--tags-only"
+  };
+
+  struct timespec t0, t1;
+  struct cache_t * cache = cache_ctor(NULL, 9, argv);
+
+  if (!cache) {
+    cfg->res = CACHE_FAILURE;
+    return;
+  }
+
+  struct cache_prof_t prof;
+
+  if (sw->prf) {
+    cache_prof_ctor(&prof);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  cache_reset(cache, NULL);
+
+  if (sw->prf) {
+    cache_prof_start(&prof);
+  }
+
+  size_t acci;
+
+  for (acci = 0; acci < sw->accc; ++acci) {
+    const struct sweep_acc_t * acc = sw->accv + acci;
+
+    u_word_t len = acc->len < cache->datc ? acc->len : cache->datc;
+
+    switch (acc->op) {
+    case _SWEEP_RD:
+      if (CACHE_FAILURE == cache_read(cache, acc->adr, len, NULL)) {
+        cache_fill(cache, acc->adr, NULL);
+      }
+      break;
+
+    case _SWEEP_WR:
+      cache_write(cache, acc->adr, len, NULL);
+      break;
+
+    default:
+      cache_fill(cache, acc->adr, NULL);
+      break;
+    }
+  }
+
+  if (sw->prf) {
+    cache_prof_stop(&prof);
+    cfg->prf_avlm = prof.avlm;
+    memcpy(cfg->prf_valv, prof.valv, sizeof(prof.valv));
+    cache_prof_dtor(&prof);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  cfg->res     = CACHE_SUCCESS;
+  cfg->accc    = (u_long_t)sw->accc;
+  cfg->rd_hitc = cache->rd_hitc;
+  cfg->rd_misc = cache->rd_misc;
+  cfg->wr_hitc = cache->wr_hitc;
+  cfg->wr_misc = cache->wr_misc;
+  cfg->secs    = (
+    (double)(t1.tv_sec  - t0.tv_sec) +
+    (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9
+  );
+
+  cache = cache_dtor(cache);
+}
+
+static int _sweep_take (
+  _InOut struct sweep_t * sw,
+  _In    u_word_t         wrki,
+  _Out   u_word_t *       _cfgi
+)
+{
+  struct sweep_deq_t * own = sw->deqv + wrki;
+  u_word_t             vici;
+
+  pthread_mutex_lock(&own->mtx);
+
+  if (own->lo < own->hi) {
+    *_cfgi = own->lo++;
+    pthread_mutex_unlock(&own->mtx);
+    return CACHE_SUCCESS;
+  }
+
+  pthread_mutex_unlock(&own->mtx);
+
+  for (vici = U_WORD(1); vici < sw->deqc; ++vici) {
+    struct sweep_deq_t * vic = sw->deqv + (wrki + vici) % sw->deqc;
+    u_word_t             lo, hi;
+
+    pthread_mutex_lock(&vic->mtx);
+
+    if (vic->hi <= vic->lo) {
+      pthread_mutex_unlock(&vic->mtx);
+      continue;
+    }
+
+    /* steal the back half, rounding up so a single item moves too */
+
+    hi = vic->hi;
+    lo = hi - (hi - vic->lo + U_WORD(1)) / U_WORD(2);
+    vic->hi = lo;
+
+    pthread_mutex_unlock(&vic->mtx);
+
+    pthread_mutex_lock(&own->mtx);
+    own->lo = lo + U_WORD(1);
+    own->hi = hi;
+    pthread_mutex_unlock(&own->mtx);
+
+    *_cfgi = lo;
+    return CACHE_SUCCESS;
+  }
+
+  return CACHE_FAILURE;
+}
+
+static void * _sweep_worker (
+  _In    void * arg
+)
+{
+  struct sweep_worker_t * wrk = (struct sweep_worker_t *)arg;
+  u_word_t                cfgi;
+
+  while (!_sweep_take(wrk->sw, wrk->wrki, &cfgi)) {
+    _sweep_run(wrk->sw, wrk->sw->cfgv + cfgi);
+  }
+
+  return NULL;
+}
+
+/* runs every configuration of `sw` on `jobc` workers */
+
+static int _sweep_pool (
+  _InOut struct sweep_t * sw,
+  _In    long             jobc
+)
+{
+  pthread_t *             thrv = NULL;
+  struct sweep_worker_t * wrkv = NULL;
+  u_word_t                wrki, thri;
+
+  sw->deqc = jobc < 1 ? U_WORD(1) : (u_word_t)jobc;
+
+  if (sw->cfgc < sw->deqc) {
+    sw->deqc = sw->cfgc;
+  }
+
+  sw->deqv = (struct sweep_deq_t *)calloc(
+    sw->deqc, sizeof(struct sweep_deq_t)
+  );
+  thrv     = (pthread_t *)calloc(sw->deqc, sizeof(pthread_t));
+  wrkv     = (struct sweep_worker_t *)calloc(
+    sw->deqc, sizeof(struct sweep_worker_t)
+  );
+
+  if (!sw->deqv || !thrv || !wrkv) {
+    free(wrkv);
+    free(thrv);
+    free(sw->deqv);
+    sw->deqv = NULL;
+    return CACHE_FAILURE;
+  }
+
+  for (wrki = U_WORD(0); wrki < sw->deqc; ++wrki) {
+    pthread_mutex_init(&sw->deqv[wrki].mtx, NULL);
+    sw->deqv[wrki].lo = (u_word_t)((u_long_t)sw->cfgc * wrki / sw->deqc);
+    sw->deqv[wrki].hi = (
+      (u_word_t)((u_long_t)sw->cfgc * (wrki + 1) / sw->deqc)
+    );
+    wrkv[wrki].sw     = sw;
+    wrkv[wrki].wrki   = wrki;
+  }
+
+  for (wrki = U_WORD(1); wrki < sw->deqc; ++wrki) {
+    if (pthread_create(thrv + wrki, NULL, _sweep_worker, wrkv + wrki))
+      break;
+  }
+
+  /* the main thread is worker 0, and drains the ranges of failed threads */
+
+  _sweep_worker(wrkv);
+
+  for (thri = U_WORD(1); thri < wrki; ++thri) {
+    pthread_join(thrv[thri], NULL);
+  }
+
+  for (wrki = U_WORD(0); wrki < sw->deqc; ++wrki) {
+    pthread_mutex_destroy(&sw->deqv[wrki].mtx);
+  }
+
+  free(wrkv);
+  free(thrv);
+  free(sw->deqv);
+  sw->deqv = NULL;
+
+  return CACHE_SUCCESS;
+}
+
+static void _sweep_print_prof (
+  _In    u_word_t         avlm,
+  _In    const u_long_t * valv,
+  _In    u_long_t         accc,
+  _Out   FILE *           fp
+)
+{
+  u_word_t cnti;
+
+  for (cnti = U_WORD(0); cnti < CACHE_PROF_CNTC; ++cnti) {
+    if (avlm & (U_WORD(1) << cnti) && accc) {
+      fprintf(fp, " %10.3f |", (double)valv[cnti] / (double)accc);
+    } else {
+      fprintf(fp, " %10s |", "-");
+    }
+  }
+}
+
+static void _sweep_print (
+  _In    const struct sweep_t * sw,
+  _Out   FILE *                 fp
+)
+{
+  u_word_t cfgi, cnti;
+
+  fprintf(
+    fp,
+    "| %-24s | %-8s | %12s | %12s | %12s | %12s | %12s | %9s | %9s |",
+    "GEOMETRY", "POLICY", "ACCESSES",
+    "RD HITS", "RD MISSES", "WR HITS", "WR MISSES",
+    "MISS RATE", "SECONDS"
+  );
+
+  for (cnti = U_WORD(0); sw->prf && cnti < CACHE_PROF_CNTC; ++cnti) {
+    fprintf(fp, " %10s |", cache_prof_name(cnti));
+  }
+
+  fprintf(fp, "\n");
+
+  for (cfgi = U_WORD(0); cfgi < sw->cfgc; ++cfgi) {
+    const struct sweep_cfg_t * cfg = sw->cfgv + cfgi;
+
+    if (cfg->res) {
+      fprintf(
+        fp, "| %-24s | %-8s | %12s |\n", cfg->geom, cfg->policy, "INVALID"
+      );
+      continue;
+    }
+
+    u_long_t accc = cfg->rd_hitc + cfg->rd_misc + cfg->wr_hitc + cfg->wr_misc;
+    u_long_t misc = cfg->rd_misc + cfg->wr_misc;
+
+    fprintf(
+      fp,
+      "| %-24s | %-8s | %12" U_LONG_FMTD " | %12" U_LONG_FMTD
+      " | %12" U_LONG_FMTD " | %12" U_LONG_FMTD " | %12" U_LONG_FMTD
+      " | %9.6f | %9.3f |",
+      cfg->geom, cfg->policy, cfg->accc,
+      cfg->rd_hitc, cfg->rd_misc, cfg->wr_hitc, cfg->wr_misc,
+      accc ? (double)misc / (double)accc : 0.0,
+      cfg->secs
+    );
+
+    if (sw->prf) {
+      _sweep_print_prof(cfg->prf_avlm, cfg->prf_valv, cfg->accc, fp);
+    }
+
+    fprintf(fp, "\n");
+  }
+}
+
+/* one stack-distance pass over the reads and writes of the trace */
+
+static int _sweep_sdist (
+  _In    const struct sweep_t * sw,
+  _In    const char *           range,
+  _Out   FILE *                 fp
+)
+{
+  u_word_t datz, sets_lo, sets_hi, wayc;
+  int      len = 0;
+
+  int res = sscanf(
+    range, "%" SCNu32 ":%" SCNu32 ":%" SCNu32 ":%" SCNu32 "%n",
+    &datz, &sets_lo, &sets_hi, &wayc, &len
+  );
+
+  if (4 != res || range[len] || 32 <= sets_hi || U_HALF_MAX < wayc)
+    return CACHE_FAILURE;
+
+  struct cache_sdist_t sd;
+
+  if (!cache_sdist_ctor(&sd, datz, sets_lo, sets_hi, wayc))
+    return CACHE_FAILURE;
+
+  size_t acci;
+
+  for (acci = 0; acci < sw->accc; ++acci) {
+    if (_SWEEP_FL != sw->accv[acci].op) {
+      cache_sdist_access(&sd, sw->accv[acci].adr);
+    }
+  }
+
+  cache_sdist_print(&sd, fp);
+  cache_sdist_dtor(&sd);
+
+  return CACHE_SUCCESS;
+}
+
+static int _sweep_check (
+  _Out   FILE *       fp,
+  _In    const char * what,
+  _In    int          ok
+)
+{
+  fprintf(fp, "| %-40s %s\n", what, ok ? "OK" : "FAILED");
+
+  return !ok;
+}
+
+static int _sweep_same (
+  _In    const struct sweep_cfg_t * cfg,
+  _In    const struct sweep_cfg_t * ref
+)
+{
+  return (
+    !cfg->res && !ref->res         &&
+    cfg->rd_hitc == ref->rd_hitc   &&
+    cfg->rd_misc == ref->rd_misc   &&
+    cfg->wr_hitc == ref->wr_hitc   &&
+    cfg->wr_misc == ref->wr_misc
+  );
+}
+
+/* reads and writes only, which the stack distances see as the sweep does */
+
+static int _sweep_test (
+  _Out   FILE * fp
+)
+{
+  static const char * geomv   [] = { "32:2:4:6", "32:3:8:6", "32:4:2:6" };
+  static const char * policyv [] = { "lru", "plru", "random" };
+  static u_word_t     waycv   [] = { 4, 8, 2 };
+
+  struct sweep_t       sw   = { 0 };
+  struct sweep_cfg_t   refv [9];
+  struct sweep_cfg_t   cfgv [9];
+  struct cache_sdist_t sd;
+  u_long_t             rnd  = U_LONG(7);
+  u_word_t             cfgi;
+  size_t               acci;
+  int                  err  = 0;
+
+  sw.accc = 20000;
+  sw.cfgc = 9;
+  sw.seed = "1";
+
+  struct sweep_acc_t * accv = (struct sweep_acc_t *)calloc(
+    sw.accc, sizeof(struct sweep_acc_t)
+  );
+
+  if (!accv || !cache_sdist_ctor(&sd, 6, 2, 4, 8)) {
+    free(accv);
+    return CACHE_TEST_FAILED;
+  }
+
+  fprintf(fp, "TEST SWEEP\n");
+  fprintf(fp, ".----------\n");
+
+  /* a hot loop of 40 lines over a cold range of 256 */
+
+  for (acci = 0; acci < sw.accc; ++acci) {
+    rnd = rnd * U_LONG(6364136223846793005) + U_LONG(1442695040888963407);
+
+    u_long_t lin = (rnd >> 40) % 4 ? acci % 40 : (rnd >> 33) % 256;
+
+    accv[acci].adr = lin * 64 + (rnd >> 58);
+    accv[acci].len = U_WORD(1);
+    accv[acci].op  = (rnd >> 20) % 4 ? _SWEEP_RD : _SWEEP_WR;
+
+    cache_sdist_access(&sd, accv[acci].adr);
+  }
+
+  sw.accv = accv;
+
+  for (cfgi = U_WORD(0); cfgi < sw.cfgc; ++cfgi) {
+    refv[cfgi].geom   = geomv[cfgi / 3];
+    refv[cfgi].policy = policyv[cfgi % 3];
+  }
+
+  memcpy(cfgv, refv, sizeof(cfgv));
+
+  sw.cfgv = refv;
+  err |= _sweep_pool(&sw, 1);
+  sw.cfgv = cfgv;
+  err |= _sweep_pool(&sw, 4);
+
+  int same = !err;
+
+  for (cfgi = U_WORD(0); cfgi < sw.cfgc; ++cfgi) {
+    same &= _sweep_same(cfgv + cfgi, refv + cfgi);
+  }
+
+  err |= _sweep_check(fp, "SAME TABLE ON 1 AND 4 WORKERS", same);
+
+  int lru = 1;
+
+  for (cfgi = U_WORD(0); cfgi < sw.cfgc; cfgi += 3) {
+    const struct sweep_cfg_t * cfg = refv + cfgi;
+
+    u_long_t misc = cache_sdist_misses(
+      &sd, U_WORD(2) + cfgi / 3, waycv[cfgi / 3]
+    );
+
+    lru &= cfg->rd_misc + cfg->wr_misc == misc;
+  }
+
+  err |= _sweep_check(fp, "LRU ROWS MATCH THE STACK DISTANCES", lru);
+
+  /* another seed draws other victims */
+
+  sw.seed = "2";
+  memcpy(cfgv, refv, sizeof(cfgv));
+  err |= _sweep_pool(&sw, 4);
+
+  err |= _sweep_check(fp, "SEED CHANGES ONLY RANDOM ROWS",
+    _sweep_same(cfgv + 0, refv + 0) && _sweep_same(cfgv + 1, refv + 1) &&
+    !_sweep_same(cfgv + 2, refv + 2)
+  );
+
+  cache_sdist_dtor(&sd);
+  free(accv);
+
+  fprintf(fp, "| TEST %s\n", err ? "FAILED" : "PASSED");
+
+  return err ? CACHE_TEST_FAILED : CACHE_TEST_PASSED;
+}
+
+static void _sweep_help (
+  _Out   FILE * fp
+)
+{
+  fprintf(
+    fp,
+    "usage: hw-cache-sweep [options] TRACE\n"
+    "\n"
+    "options:\n"
+    "  -h, --help              --- Print this message.\n"
+    "  -j, --jobs   COUNT      --- Set the number of worker threads.\n"
+    "  -g, --geom   GEOMETRY   --- Add a geometry to the sweep.\n"
+    "  -p, --policy METHODS    --- Add a policy to the sweep.\n"
+    "  -o, --output FILE       --- Write the table to FILE.\n"
+    "  -P, --profile           --- Report host counters per access.\n"
+    "  -d, --sdist  RANGE      --- Add an LRU stack-distance table.\n"
+    "  -r, --seed   SEED       --- Seed the random policy, 1 by default.\n"
+    "  -t, --test              --- Run the self-test and exit.\n"
+    "\n"
+    "Every geometry is paired with every policy; both take the formats\n"
+    "of the `cache_ctor` options. A range is DATZ:SETZ_LO:SETZ_HI:WAYC,\n"
+    "the line offset bits, the set index bits and the deepest ways.\n"
+  );
+}
+
+int main (int argc, char ** argv)
+{
+  const char ** geomv   = (const char **)calloc(argc, sizeof(char *));
+  const char ** policyv = (const char **)calloc(argc, sizeof(char *));
+  const char *  trace   = NULL;
+  const char *  output  = NULL;
+  const char *  sdist   = NULL;
+  const char *  seed    = "1";
+  u_word_t      geomc   = U_WORD(0);
+  u_word_t      policyc = U_WORD(0);
+  long          jobc    = sysconf(_SC_NPROCESSORS_ONLN);
+  int           prf     = 0;
+  int           argi;
+  int           res     = EXIT_FAILURE;
+
+  if (!geomv || !policyv)
+    goto done;
+
+  for (argi = 1; argi < argc; ++argi) {
+    char * args = argv[argi];
+
+    if (0 == strcmp(args, "-h") || 0 == strcmp(args, "--help")) {
+      _sweep_help(stdout);
+      res = EXIT_SUCCESS;
+      goto done;
+    } else if (0 == strcmp(args, "-t") || 0 == strcmp(args, "--test")) {
+      res = _sweep_test(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+      goto done;
+    } else if (0 == strcmp(args, "-P") || 0 == strcmp(args, "--profile")) {
+      prf = 1;
+    } else if (argi + 1 == argc) {
+      trace = args;
+    } else if (0 == strcmp(args, "-j") || 0 == strcmp(args, "--jobs")) {
+      jobc = strtol(argv[++argi], NULL, 10);
+    } else if (0 == strcmp(args, "-g") || 0 == strcmp(args, "--geom")) {
+      geomv[geomc++] = argv[++argi];
+    } else if (0 == strcmp(args, "-p") || 0 == strcmp(args, "--policy")) {
+      policyv[policyc++] = argv[++argi];
+    } else if (0 == strcmp(args, "-o") || 0 == strcmp(args, "--output")) {
+      output = argv[++argi];
+    } else if (0 == strcmp(args, "-d") || 0 == strcmp(args, "--sdist")) {
+      sdist = argv[++argi];
+    } else if (0 == strcmp(args, "-r") || 0 == strcmp(args, "--seed")) {
+      seed = argv[++argi];
+    } else {
+      break;
+    }
+  }
+
+  if (argi < argc || !trace || !geomc) {
+    _sweep_help(stderr);
+    goto done;
+  }
+
+  if (!policyc) {
+    policyv[policyc++] = "lru";
+  }
+
+  struct sweep_t       sw   = { 0 };
+  struct sweep_acc_t * accv = NULL;
+  u_word_t             cfgi;
+
+  struct cache_prof_t  prof = { 0 };
+  struct cache_prof_t  dec_prof = { 0 };
+
+  if (prf) {
+    cache_prof_ctor(&prof);
+    cache_prof_start(&prof);
+  }
+
+  int dec = _sweep_decode(trace, &accv, &sw.accc);
+
+  if (prf) {
+    cache_prof_stop(&prof);
+    dec_prof = prof;
+    cache_prof_dtor(&prof);
+  }
+
+  if (dec) {
+    fprintf(stderr, "hw-cache-sweep: cannot decode `%s`\n", trace);
+    goto done;
+  }
+
+  sw.prf  = prf;
+  sw.seed = seed;
+  sw.accv = accv;
+  sw.cfgc = geomc * policyc;
+  sw.cfgv = (struct sweep_cfg_t *)calloc(sw.cfgc, sizeof(struct sweep_cfg_t));
+
+  if (!sw.cfgv)
+    goto fail;
+
+  for (cfgi = U_WORD(0); cfgi < sw.cfgc; ++cfgi) {
+    sw.cfgv[cfgi].geom   = geomv[cfgi / policyc];
+    sw.cfgv[cfgi].policy = policyv[cfgi % policyc];
+  }
+
+  if (_sweep_pool(&sw, jobc))
+    goto fail;
+
+  FILE * fp = output ? fopen(output, "w") : stdout;
+
+  if (fp) {
+    _sweep_print(&sw, fp);
+
+    if (prf) {
+      fprintf(fp, "| %-24s |", "DECODE");
+      _sweep_print_prof(
+        dec_prof.avlm, dec_prof.valv, (u_long_t)sw.accc, fp
+      );
+      fprintf(fp, "\n");
+    }
+
+    res = EXIT_SUCCESS;
+
+    if (sdist && _sweep_sdist(&sw, sdist, fp)) {
+      fprintf(
+        stderr, "hw-cache-sweep: bad stack-distance range `%s`\n", sdist
+      );
+      res = EXIT_FAILURE;
+    }
+
+    if (stdout != fp)
+      fclose(fp);
+  }
+
+fail:
+  free(sw.cfgv);
+  free(accv);
+done:
+  free(policyv);
+  free(geomv);
+  return res;
+}
@@ -0,0 +1,414 @@
+# include "tlb.h"
+# include <stdlib.h>
+# include <string.h>
+
+static const u_word_t _cache_tlb_pgsv[CACHE_TLB_PGSC] = { 12, 21, 30 };
+static const char *   _cache_tlb_pgnv[CACHE_TLB_PGSC] = { "4k", "2m", "1g" };
+
+/* payload: page frame number above the four permission bits */
+
+# define _TLB_PERM_BITS 4
+
+static int _cache_tlb_parse (
+  _In    const char * spec,
+  _Out   u_word_t     setzv[CACHE_TLB_PGSC],
+  _Out   u_word_t     waycv[CACHE_TLB_PGSC]
+)
+{
+  while (*spec) {
+    char     name[4];
+    u_word_t setz, wayc, pgsi;
+    int      len = 0;
+
+    int res = sscanf(
+      spec, "%3[^=]=%" SCNu32 ":%" SCNu32 "%n", name, &setz, &wayc, &len
+    );
+
+    if (res < 3 || !wayc)
+      return CACHE_FAILURE;
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      if (0 == strcmp(name, _cache_tlb_pgnv[pgsi]))
+        break;
+    }
+
+    if (CACHE_TLB_PGSC == pgsi)
+      return CACHE_FAILURE;
+
+    setzv[pgsi] = setz;
+    waycv[pgsi] = wayc;
+    spec       += len;
+
+    if (',' == *spec) {
+      ++spec;
+    } else if (*spec) {
+      return CACHE_FAILURE;
+    }
+  }
+
+  return CACHE_SUCCESS;
+}
+
+struct cache_tlb_t * cache_tlb_ctor (
+  _InOut struct cache_tlb_t * tlb,
+  _In    int                  argc,
+  _In    char **              argv
+)
+{
+  if (!tlb) {
+    tlb = (struct cache_tlb_t *)malloc(sizeof(struct cache_tlb_t));
+
+    if (!tlb)
+      return tlb;
+
+    memset(tlb, 0, sizeof(struct cache_tlb_t));
+    cache_tlb_set_ho(tlb);
+  } else {
+    memset(tlb, 0, sizeof(struct cache_tlb_t));
+  }
+
+  u_word_t setzv[CACHE_TLB_LVLC][CACHE_TLB_PGSC] = { { 0 } };
+  u_word_t waycv[CACHE_TLB_LVLC][CACHE_TLB_PGSC] = { { 0 } };
+  char *   policy = "lru";
+  int      argi;
+
+  tlb->vaz  = U_WORD(48);
+  tlb->lvlc = U_WORD(1);
+
+  for (argi = 0; argi < argc; ++argi) {
+    char * args = argv[argi];
+    char * argn = argi + 1 < argc ? argv[argi + 1] : NULL;
+    int    res  = CACHE_FAILURE;
+
+    if (argn && 0 == strcmp(args, "--va")) {
+      int len = 0;
+
+      res = (
+        1 != sscanf(argn, "%" SCNu32 "%n", &tlb->vaz, &len) || argn[len]
+      ) ? CACHE_FAILURE : CACHE_SUCCESS;
+    } else if (argn && 0 == strcmp(args, "--l1")) {
+      res = _cache_tlb_parse(argn, setzv[0], waycv[0]);
+    } else if (argn && 0 == strcmp(args, "--l2")) {
+      res = _cache_tlb_parse(argn, setzv[1], waycv[1]);
+      tlb->lvlc = U_WORD(2);
+    } else if (argn && 0 == strcmp(args, "--policy")) {
+      policy = argn;
+      res    = CACHE_SUCCESS;
+    }
+
+    if (res) {
+      tlb = cache_tlb_dtor(tlb);
+      return NULL;
+    }
+
+    ++argi;
+  }
+
+  /* the smallest page must leave a virtual page number */
+
+  if (64 < tlb->vaz || tlb->vaz <= _cache_tlb_pgsv[CACHE_TLB_4K]) {
+    tlb = cache_tlb_dtor(tlb);
+    return NULL;
+  }
+
+  u_word_t lvli, pgsi;
+
+  for (lvli = U_WORD(0); lvli < tlb->lvlc; ++lvli) {
+    struct cache_tlb_lvl_t * lvl = tlb->lvlv + lvli;
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      char geom[64];
+
+      if (!waycv[lvli][pgsi] || tlb->vaz <= _cache_tlb_pgsv[pgsi])
+        continue;
+
+      /* one 8-byte line per virtual page number */
+
+      snprintf(
+        geom, sizeof(geom),
+        "%" U_WORD_FMTD ":%" U_WORD_FMTD ":%" U_WORD_FMTD ":3",
+        tlb->vaz - _cache_tlb_pgsv[pgsi] + U_WORD(3),
+        setzv[lvli][pgsi], waycv[lvli][pgsi]
+      );
+
+      char * cache_argv[] = {
+        "--geom", geom, "--policy", policy, "--flush", "none"
+      };
+
+      if (!cache_ctor(lvl->arrv + pgsi, 6, cache_argv)) {
+        tlb = cache_tlb_dtor(tlb);
+        return NULL;
+      }
+
+      lvl->arrm |= U_WORD(1) << pgsi;
+    }
+
+    if (!lvl->arrm) {
+      tlb = cache_tlb_dtor(tlb);
+      return NULL;
+    }
+  }
+
+  cache_tlb_reset(tlb);
+
+  return tlb;
+}
+
+struct cache_tlb_t * cache_tlb_dtor (
+  _InOut struct cache_tlb_t * tlb
+)
+{
+  if (!tlb)
+    return tlb;
+
+  u_word_t lvli, pgsi;
+
+  for (lvli = U_WORD(0); lvli < CACHE_TLB_LVLC; ++lvli) {
+    struct cache_tlb_lvl_t * lvl = tlb->lvlv + lvli;
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      if (lvl->arrm & (U_WORD(1) << pgsi)) {
+        cache_dtor(lvl->arrv + pgsi);
+      }
+    }
+
+    lvl->arrm = U_WORD(0);
+  }
+
+  if (cache_tlb_get_ho(tlb)) {
+    free(tlb);
+    tlb = NULL;
+  }
+
+  return tlb;
+}
+
+int cache_tlb_reset (
+  _InOut struct cache_tlb_t * tlb
+)
+{
+  u_word_t lvli, pgsi;
+
+  for (lvli = U_WORD(0); lvli < tlb->lvlc; ++lvli) {
+    struct cache_tlb_lvl_t * lvl = tlb->lvlv + lvli;
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      if (!(lvl->arrm & (U_WORD(1) << pgsi)))
+        continue;
+
+      if (cache_reset(lvl->arrv + pgsi, NULL))
+        return CACHE_FAILURE;
+    }
+
+    lvl->hitc = U_LONG(0);
+    lvl->misc = U_LONG(0);
+  }
+
+  tlb->fltc = U_LONG(0);
+
+  return CACHE_SUCCESS;
+}
+
+static int _cache_tlb_lvl_fill (
+  _InOut struct cache_tlb_lvl_t * lvl,
+  _In    u_long_t                 va,
+  _In    u_word_t                 pgsi,
+  _In    u_long_t                 pld
+)
+{
+  if (!(lvl->arrm & (U_WORD(1) << pgsi)))
+    return CACHE_SKIPPED;
+
+  struct cache_t *   arr = lvl->arrv + pgsi;
+  struct cache_pin_t pin;
+  u_long_t           adr = (va >> _cache_tlb_pgsv[pgsi]) << 3;
+  u_byte_t           dat[8];
+
+  memcpy(dat, &pld, sizeof(dat));
+
+  /*
+   * A fill, not a write, so that installing counts no access; the fill
+   * keeps the payload of an entry already present, so a remapped page is
+   * overwritten in place.
+   */
+
+  if (CACHE_SUCCESS == cache_pin_retry(arr, adr, 8, &pin)) {
+    memcpy(pin.dat, dat, sizeof(dat));
+    cache_unpin(arr, &pin);
+
+    return CACHE_SUCCESS;
+  }
+
+  return cache_fill(arr, adr, dat);
+}
+
+int cache_tlb_lookup (
+  _InOut struct cache_tlb_t *     tlb,
+  _In    u_long_t                 va,
+  _Out   struct cache_tlb_ent_t * ent,
+  _Out   u_word_t *               _lvli
+)
+{
+  u_word_t lvli, pgsi;
+
+  for (lvli = U_WORD(0); lvli < tlb->lvlc; ++lvli) {
+    struct cache_tlb_lvl_t * lvl = tlb->lvlv + lvli;
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      u_byte_t dat[8];
+      u_long_t pld;
+
+      if (!(lvl->arrm & (U_WORD(1) << pgsi)))
+        continue;
+
+      int res = cache_read(
+        lvl->arrv + pgsi, (va >> _cache_tlb_pgsv[pgsi]) << 3, 8, dat
+      );
+
+      if (res)
+        continue;
+
+      memcpy(&pld, dat, sizeof(pld));
+
+      u_word_t pgs = _cache_tlb_pgsv[pgsi];
+      u_long_t pgm = (U_LONG(1) << pgs) - U_LONG(1);
+      u_word_t prm = (U_WORD(1) << _TLB_PERM_BITS) - U_WORD(1);
+      u_word_t upi;
+
+      ent->pa   = ((pld >> _TLB_PERM_BITS) << pgs) | (va & pgm);
+      ent->pgsi = pgsi;
+      ent->perm = (u_word_t)pld & prm;
+
+      ++lvl->hitc;
+
+      /* refill the levels above */
+
+      for (upi = U_WORD(0); upi < lvli; ++upi) {
+        _cache_tlb_lvl_fill(tlb->lvlv + upi, va, pgsi, pld);
+      }
+
+      if (_lvli) {
+        *_lvli = lvli;
+      }
+
+      return CACHE_SUCCESS;
+    }
+
+    ++lvl->misc;
+  }
+
+  return CACHE_FAILURE;
+}
+
+int cache_tlb_fill (
+  _InOut struct cache_tlb_t *           tlb,
+  _In    u_long_t                       va,
+  _In    const struct cache_tlb_ent_t * ent
+)
+{
+  if (CACHE_TLB_PGSC <= ent->pgsi)
+    return CACHE_FAILURE;
+
+  u_long_t pld  = (ent->pa >> _cache_tlb_pgsv[ent->pgsi]) << _TLB_PERM_BITS;
+  u_word_t lvli;
+  int      res  = CACHE_FAILURE;
+
+  pld |= ent->perm & ((U_WORD(1) << _TLB_PERM_BITS) - U_WORD(1));
+
+  for (lvli = U_WORD(0); lvli < tlb->lvlc; ++lvli) {
+    int lvl_res = _cache_tlb_lvl_fill(tlb->lvlv + lvli, va, ent->pgsi, pld);
+
+    if (CACHE_SKIPPED == lvl_res)
+      continue;
+
+    if (lvl_res)
+      return CACHE_FAILURE;
+
+    res = CACHE_SUCCESS;
+  }
+
+  return res;
+}
+
+int cache_tlb_access (
+  _InOut struct cache_tlb_t * tlb,
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             va,
+  _In    u_word_t             len,
+  _In    u_word_t             perm
+)
+{
+  struct cache_tlb_ent_t ent;
+
+  if (cache_tlb_lookup(tlb, va, &ent, NULL)) {
+    if (!tlb->walk || tlb->walk(tlb, va, &ent)) {
+      ++tlb->fltc;
+      return CACHE_FAILURE;
+    }
+
+    int res = cache_tlb_fill(tlb, va, &ent);
+
+    if (res)
+      return res;
+
+    u_long_t pgm = (U_LONG(1) << _cache_tlb_pgsv[ent.pgsi]) - U_LONG(1);
+
+    ent.pa = (ent.pa & ~pgm) | (va & pgm);
+  }
+
+  if ((ent.perm & perm) != perm) {
+    ++tlb->fltc;
+    return CACHE_FAILURE;
+  }
+
+  if (perm & CACHE_TLB_W)
+    return cache_write(cache, ent.pa, len, NULL);
+
+  if (CACHE_FAILURE == cache_read(cache, ent.pa, len, NULL))
+    return cache_fill(cache, ent.pa, NULL);
+
+  return CACHE_SUCCESS;
+}
+
+void cache_tlb_print (
+  _In    const struct cache_tlb_t * tlb,
+  _Out   FILE *                     fp
+)
+{
+  u_word_t lvli, pgsi;
+
+  fprintf(
+    fp,
+    "TLB (%" U_WORD_FMTD " BIT VIRTUAL ADDRESSES, %" U_LONG_FMTD " FAULTS)"
+    "\n",
+    tlb->vaz, tlb->fltc
+  );
+
+  for (lvli = U_WORD(0); lvli < tlb->lvlc; ++lvli) {
+    const struct cache_tlb_lvl_t * lvl = tlb->lvlv + lvli;
+
+    u_long_t accc = lvl->hitc + lvl->misc;
+
+    fprintf(
+      fp,
+      "| L%" U_WORD_FMTD " HITS %12" U_LONG_FMTD " MISSES %12" U_LONG_FMTD
+      " MISS RATE %9.6f |",
+      lvli + U_WORD(1), lvl->hitc, lvl->misc,
+      accc ? (double)lvl->misc / (double)accc : 0.0
+    );
+
+    for (pgsi = U_WORD(0); pgsi < CACHE_TLB_PGSC; ++pgsi) {
+      const struct cache_t * arr = lvl->arrv + pgsi;
+
+      if (!(lvl->arrm & (U_WORD(1) << pgsi)))
+        continue;
+
+      fprintf(
+        fp, " %s %" U_WORD_FMTD "x%" U_WORD_FMTD,
+        _cache_tlb_pgnv[pgsi], arr->setc, arr->wayc
+      );
+    }
+
+    fprintf(fp, "\n");
+  }
+}
@@ -0,0 +1,126 @@
+# ifndef __TLB_H
+#   define __TLB_H
+
+#   include "cache.h"
+
+/*
+ * TLB model on top of the set-associative engine. Every level keeps one
+ * array per page size (4 KiB, 2 MiB, 1 GiB), all indexed in parallel by
+ * their own virtual page number; the line of an entry is an 8-byte
+ * payload holding the page frame number and the permission bits, so a
+ * lookup runs exactly the data path of `cache_read`.
+ *
+ * Lookups probe the first level, then the second; a second-level hit is
+ * refilled into the first level. On a full miss the caller walks its page
+ * tables and installs the translation with `cache_tlb_fill`, which fills
+ * both levels. Installing is a fill of the arrays, not an access.
+ *
+ * `cache_tlb_access` co-simulates a data access in one call: it translates
+ * the virtual address, walking with the `walk` callback on a full miss,
+ * and replays the access on the physical address in a data cache, a read
+ * miss filling the line like the sweep does.
+ */
+
+#   define CACHE_TLB_4K   0
+#   define CACHE_TLB_2M   1
+#   define CACHE_TLB_1G   2
+#   define CACHE_TLB_PGSC 3
+
+#   define CACHE_TLB_LVLC 2
+
+#   define CACHE_TLB_R 0x1
+#   define CACHE_TLB_W 0x2
+#   define CACHE_TLB_X 0x4
+#   define CACHE_TLB_U 0x8
+
+struct cache_tlb_ent_t {
+  u_long_t pa;
+  u_word_t pgsi;
+  u_word_t perm;
+};
+
+struct cache_tlb_lvl_t {
+  u_word_t       arrm;                  /* page sizes present */
+  struct cache_t arrv[CACHE_TLB_PGSC];
+  u_long_t       hitc;
+  u_long_t       misc;
+};
+
+struct cache_tlb_t {
+  u_word_t               sr;
+  u_word_t               vaz;  /* in bits */
+  u_word_t               lvlc;
+  struct cache_tlb_lvl_t lvlv[CACHE_TLB_LVLC];
+  u_long_t               fltc; /* page faults of `cache_tlb_access` */
+
+  /* optional: the page walk of `cache_tlb_access`, nonzero on a fault */
+
+  int ( * walk ) (
+    _InOut struct cache_tlb_t *     /* tlb */,
+    _In    u_long_t                 /* va  */,
+    _Out   struct cache_tlb_ent_t * /* ent */
+  );
+};
+
+#   define cache_tlb_clr_ho(tlb) (tlb)->sr &= ~0x1
+#   define cache_tlb_set_ho(tlb) (tlb)->sr |= 0x1
+#   define cache_tlb_get_ho(tlb) ((tlb)->sr & 0x1)
+
+/*
+ * Options:
+ *   --va     BITS   virtual address bits, 48 by default
+ *   --l1     ARRAYS first level arrays, e.g. 4k=4:16,2m=2:8,1g=0:4
+ *   --l2     ARRAYS second level arrays, none by default
+ *   --policy METHOD replacement policy of every array, see `cache_ctor`
+ *
+ * where each array is PAGE=SETZ:WAYC, with set index bits and ways.
+ */
+
+struct cache_tlb_t * cache_tlb_ctor (
+  _InOut struct cache_tlb_t * tlb,
+  _In    int                  argc,
+  _In    char **              argv
+);
+
+struct cache_tlb_t * cache_tlb_dtor (
+  _InOut struct cache_tlb_t * tlb
+);
+
+int cache_tlb_reset (
+  _InOut struct cache_tlb_t * tlb
+);
+
+/* CACHE_SUCCESS with the translation of `va` and its level, or a miss */
+
+int cache_tlb_lookup (
+  _InOut struct cache_tlb_t *     tlb,
+  _In    u_long_t                 va,
+  _Out   struct cache_tlb_ent_t * ent,
+  _Out   u_word_t *               lvli
+);
+
+int cache_tlb_fill (
+  _InOut struct cache_tlb_t *           tlb,
+  _In    u_long_t                       va,
+  _In    const struct cache_tlb_ent_t * ent
+);
+
+/*
+ * CACHE_FAILURE on a page fault: the walk failed or the translation lacks
+ * one of the `perm` bits. CACHE_TLB_W makes the access a write.
+ */
+
+int cache_tlb_access (
+  _InOut struct cache_tlb_t * tlb,
+  _InOut struct cache_t *     cache,
+  _In    u_long_t             va,
+  _In    u_word_t             len,
+  _In    u_word_t             perm
+);
+
+void cache_tlb_print (
+  _In    const struct cache_tlb_t * tlb,
+  _Out   FILE *                     fp
+);
+
+# endif